@@ -0,0 +1,272 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cinttypes>
+#include "EnergyModel.hpp"
+#include "InstEntry.hpp"
+
+
+using namespace WdRiscv;
+
+
+/// Set type to the instruction type corresponding to the given name.
+/// Return true on success and false if name is not that of a type.
+static bool
+instTypeFromName(const std::string& name, InstType& type)
+{
+  static const std::unordered_map<std::string, InstType> types = {
+    { "load", InstType::Load },        { "store", InstType::Store },
+    { "multiply", InstType::Multiply }, { "divide", InstType::Divide },
+    { "branch", InstType::Branch },    { "int", InstType::Int },
+    { "fp", InstType::Fp },            { "csr", InstType::Csr },
+    { "atomic", InstType::Atomic },    { "vector", InstType::Vector },
+    { "zba", InstType::Zba },          { "zbb", InstType::Zbb },
+    { "zbc", InstType::Zbc },          { "zbe", InstType::Zbe },
+    { "zbf", InstType::Zbf },          { "zbm", InstType::Zbm },
+    { "zbp", InstType::Zbp },          { "zbr", InstType::Zbr },
+    { "zbs", InstType::Zbs },          { "zbt", InstType::Zbt }
+  };
+
+  auto iter = types.find(name);
+  if (iter == types.end())
+    return false;
+  type = iter->second;
+  return true;
+}
+
+
+bool
+EnergyModel::loadTable(const std::string& path, const InstTable& instTable)
+{
+  std::ifstream ifs(path);
+  if (not ifs)
+    {
+      std::cerr << "Failed to open energy table file " << path << '\n';
+      return false;
+    }
+
+  bool hasDefault = false, hasCustom = false;
+  double defaultEnergy = 0, customEnergy = 0;
+  std::unordered_map<unsigned, double> typeEnergy;
+  std::unordered_map<unsigned, double> idEnergy;
+  double dccm = 0, external = 0;
+
+  bool errors = false;
+  unsigned lineNum = 0;
+  std::string line;
+  while (std::getline(ifs, line))
+    {
+      lineNum++;
+      auto hash = line.find('#');
+      if (hash != std::string::npos)
+        line.erase(hash);
+
+      std::istringstream iss(line);
+      std::string key;
+      if (not (iss >> key))
+        continue;  // Empty line.
+
+      std::string name;
+      double energy = 0;
+      bool ok = true;
+
+      if (key == "default")
+        {
+          ok = bool(iss >> energy);
+          defaultEnergy = energy;
+          hasDefault = true;
+        }
+      else if (key == "custom")
+        {
+          ok = bool(iss >> energy);
+          customEnergy = energy;
+          hasCustom = true;
+        }
+      else if (key == "type")
+        {
+          InstType type = InstType::Int;
+          ok = (iss >> name >> energy) and instTypeFromName(name, type);
+          typeEnergy[unsigned(type)] = energy;
+        }
+      else if (key == "inst")
+        {
+          ok = bool(iss >> name >> energy);
+          const InstEntry& entry = instTable.getEntry(name);
+          if (ok and entry.instId() == InstId::illegal and name != "illegal")
+            {
+              std::cerr << "File " << path << ", line " << lineNum
+                        << ": No such instruction: " << name << '\n';
+              errors = true;
+              continue;
+            }
+          idEnergy[unsigned(entry.instId())] = energy;
+        }
+      else if (key == "mem")
+        {
+          ok = bool(iss >> name >> energy);
+          if (name == "dccm")
+            dccm = energy;
+          else if (name == "external")
+            external = energy;
+          else
+            ok = false;
+        }
+      else
+        ok = false;
+
+      if (not ok)
+        {
+          std::cerr << "File " << path << ", line " << lineNum
+                    << ": Invalid energy table entry: " << line << '\n';
+          errors = true;
+        }
+    }
+
+  if (errors)
+    return false;
+
+  std::vector<bool> isCustom(size_t(InstId::maxId) + 1);
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+  isCustom.at(size_t(InstId::id)) = true;
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+
+  instEnergy_.assign(size_t(InstId::maxId) + 1, 0);
+  for (size_t i = 0; i < instEnergy_.size(); ++i)
+    {
+      const InstEntry& entry = instTable.getEntry(InstId(i));
+      auto idIter = idEnergy.find(unsigned(i));
+      auto typeIter = typeEnergy.find(unsigned(entry.type()));
+
+      double energy = 0;
+      if (idIter != idEnergy.end())
+        energy = idIter->second;
+      else if (hasCustom and isCustom.at(i))
+        energy = customEnergy;
+      else if (typeIter != typeEnergy.end())
+        energy = typeIter->second;
+      else if (hasDefault)
+        energy = defaultEnergy;
+      instEnergy_.at(i) = energy;
+    }
+
+  dccmEnergy_ = dccm;
+  externalEnergy_ = external;
+  clearCounts();
+  return true;
+}
+
+
+void
+EnergyModel::clearCounts()
+{
+  totalEnergy_ = 0;
+  memEnergy_ = 0;
+  instCount_ = 0;
+  dccmAccesses_ = 0;
+  externalAccesses_ = 0;
+
+  funcs_.clear();
+  funcs_.push_back(FuncEnergy());
+  funcs_.front().name = "<unknown>";
+  funcIndex_.clear();
+  funcLow_ = 1;
+  funcHigh_ = 0;
+  funcIx_ = 0;
+}
+
+
+void
+EnergyModel::selectFunction(uint64_t pc)
+{
+  // Outside any function: Cache the negative result per page so that
+  // code between functions does not repeat the symbol lookup.
+  uint64_t page = pc >> gapPageShift_;
+  if (page != gapPage_)
+    {
+      auto iter = gapPages_.find(page);
+      gapBits_ = iter == gapPages_.end() ? nullptr : &iter->second;
+      gapPage_ = page;
+    }
+  size_t bit = (pc & ((uint64_t(1) << gapPageShift_) - 1)) >> 1;
+  if (gapBits_ and gapBits_->test(bit))
+    {
+      funcIx_ = 0;
+      funcLow_ = 1;
+      funcHigh_ = 0;
+      return;
+    }
+
+  std::string name;
+  uint64_t start = 0, size = 0;
+  if (not lookup_ or not lookup_(pc, name, start, size) or size == 0)
+    {
+      if (not gapBits_)
+        gapBits_ = &gapPages_[page];
+      gapBits_->set(bit);
+      funcIx_ = 0;
+      funcLow_ = 1;
+      funcHigh_ = 0;
+      return;
+    }
+
+  funcLow_ = start;
+  funcHigh_ = start + size;
+
+  auto iter = funcIndex_.find(start);
+  if (iter != funcIndex_.end())
+    {
+      funcIx_ = iter->second;
+      return;
+    }
+
+  funcIx_ = funcs_.size();
+  funcIndex_[start] = funcIx_;
+  FuncEnergy func;
+  func.name = name;
+  func.start = start;
+  funcs_.push_back(func);
+}
+
+
+void
+EnergyModel::report(FILE* file, uint64_t hashedBytes) const
+{
+  fprintf(file, "Energy: %g (instructions: %g, memory: %g)\n",
+          totalEnergy_, totalEnergy_ - memEnergy_, memEnergy_);
+  fprintf(file, "Instructions: %" PRIu64 "  energy/instruction: %g\n",
+          instCount_, instCount_ ? totalEnergy_ / double(instCount_) : 0.0);
+  fprintf(file, "Data accesses: dccm %" PRIu64 "  external %" PRIu64 "\n",
+          dccmAccesses_, externalAccesses_);
+  if (hashedBytes)
+    fprintf(file, "Hashed bytes: %" PRIu64 "  energy/byte: %g\n",
+            hashedBytes, totalEnergy_ / double(hashedBytes));
+
+  std::vector<const FuncEnergy*> sorted;
+  for (const auto& func : funcs_)
+    if (func.instCount)
+      sorted.push_back(&func);
+  std::sort(sorted.begin(), sorted.end(), [] (const FuncEnergy* a, const FuncEnergy* b) {
+      return a->energy > b->energy; });
+
+  fprintf(file, "\nPer function: energy instructions percent name\n");
+  for (const auto* func : sorted)
+    fprintf(file, "  %-14g %-12" PRIu64 " %6.2f%% %s\n", func->energy, func->instCount,
+            totalEnergy_ > 0 ? 100 * func->energy / totalEnergy_ : 0.0,
+            func->name.c_str());
+}
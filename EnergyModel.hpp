@@ -0,0 +1,172 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <bitset>
+#include <unordered_map>
+#include <functional>
+#include "InstId.hpp"
+
+
+namespace WdRiscv
+{
+
+  class InstTable;
+
+  /// Energy estimation model: An energy cost per instruction (by
+  /// instruction id) and per data memory access (by memory region),
+  /// and the energy accumulated by the executed instructions in total
+  /// and per function.
+  ///
+  /// The costs are loaded from a text file (typically with numbers
+  /// from synthesis) with one entry per line:
+  ///
+  ///   default <energy>             Any instruction not covered below.
+  ///   type <inst-type> <energy>    Instructions of a type: int, load,
+  ///                                store, multiply, divide, branch, fp,
+  ///                                csr, atomic, vector, zba, ..., zbt.
+  ///   custom <energy>              Custom instructions (CustomInsts.def).
+  ///   inst <mnemonic> <energy>     A specific instruction.
+  ///   mem dccm <energy>            Data access to DCCM.
+  ///   mem external <energy>        Data access outside DCCM.
+  ///
+  /// The cost of an instruction is taken from its inst line if any,
+  /// otherwise from the custom line (custom instructions), otherwise
+  /// from the type line, otherwise from the default line. Text
+  /// following a # is ignored. The unit is up to the user (e.g.
+  /// picojoules).
+  class EnergyModel
+  {
+  public:
+
+    enum class MemRegion { None, Dccm, External };
+
+    /// Function used to find the function containing an address:
+    /// Set name, start address and size and return true if found.
+    using FunctionLookup = std::function<bool(uint64_t addr, std::string& name,
+                                              uint64_t& start, uint64_t& size)>;
+
+    /// Load the energy table from the given file using the given
+    /// instruction table to resolve mnemonics. Return true on
+    /// success. Return false (printing an error message) on failure.
+    bool loadTable(const std::string& path, const InstTable& instTable);
+
+    /// Define the function used to attribute energy to functions.
+    void setFunctionLookup(FunctionLookup lookup)
+    { lookup_ = lookup; clearGaps(); }
+
+    /// Return true if an energy table was loaded.
+    bool isLoaded() const
+    { return not instEnergy_.empty(); }
+
+    /// Energy of given instruction (excluding memory access).
+    double instEnergy(InstId id) const
+    { return instEnergy_.at(size_t(id)); }
+
+    /// Account for the execution of the given instruction at the
+    /// given pc accessing data in the given memory region.
+    void account(uint64_t pc, InstId id, MemRegion region)
+    {
+      double energy = instEnergy_[size_t(id)];
+      if (region == MemRegion::Dccm)
+        {
+          memEnergy_ += dccmEnergy_;
+          energy += dccmEnergy_;
+          dccmAccesses_++;
+        }
+      else if (region == MemRegion::External)
+        {
+          memEnergy_ += externalEnergy_;
+          energy += externalEnergy_;
+          externalAccesses_++;
+        }
+      totalEnergy_ += energy;
+      instCount_++;
+
+      if (pc < funcLow_ or pc >= funcHigh_)
+        selectFunction(pc);
+      FuncEnergy& func = funcs_[funcIx_];
+      func.energy += energy;
+      func.instCount++;
+    }
+
+    /// Total accumulated energy (instructions and memory accesses).
+    double totalEnergy() const
+    { return totalEnergy_; }
+
+    /// Accumulated energy of the memory accesses.
+    double memoryEnergy() const
+    { return memEnergy_; }
+
+    /// Number of instructions accounted for.
+    uint64_t instCount() const
+    { return instCount_; }
+
+    /// Clear the accumulated energy (keeping the table).
+    void clearCounts();
+
+    /// Print the accumulated energy in total, per function (sorted by
+    /// decreasing energy) and, if hashedBytes is non-zero, per byte.
+    void report(FILE* file, uint64_t hashedBytes) const;
+
+  private:
+
+    /// Make funcIx_ refer to the function containing the given pc.
+    void selectFunction(uint64_t pc);
+
+    /// Forget the addresses known to be outside any function.
+    void clearGaps()
+    { gapPages_.clear(); gapPage_ = ~uint64_t(0); gapBits_ = nullptr; }
+
+    // One bit per half-word of a page: Set if the address is known to
+    // be outside any function.
+    static constexpr unsigned gapPageShift_ = 12;
+    using GapBits = std::bitset<(size_t(1) << gapPageShift_) / 2>;
+
+    struct FuncEnergy
+    {
+      std::string name;
+      uint64_t start = 0;
+      uint64_t instCount = 0;
+      double energy = 0;
+    };
+
+    std::vector<double> instEnergy_;  // Indexed by instruction id.
+    double dccmEnergy_ = 0;
+    double externalEnergy_ = 0;
+
+    double totalEnergy_ = 0;
+    double memEnergy_ = 0;
+    uint64_t instCount_ = 0;
+    uint64_t dccmAccesses_ = 0;
+    uint64_t externalAccesses_ = 0;
+
+    FunctionLookup lookup_;
+    std::vector<FuncEnergy> funcs_;  // Entry 0 is for code outside functions.
+    std::unordered_map<uint64_t, size_t> funcIndex_;  // Start address to index.
+    uint64_t funcLow_ = 1;   // Address range of current function: Empty
+    uint64_t funcHigh_ = 0;  // range initially.
+    size_t funcIx_ = 0;
+
+    std::unordered_map<uint64_t, GapBits> gapPages_;  // Page number to bits.
+    uint64_t gapPage_ = ~uint64_t(0);  // Page of gapBits_ (last one used).
+    GapBits* gapBits_ = nullptr;
+  };
+
+}
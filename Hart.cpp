@@ -38,6 +38,7 @@
 #endif
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/stat.h>
 
@@ -161,6 +162,29 @@ Hart<URV>::Hart(unsigned hartIx, URV hartId, Memory& memory)
   // Tie the FCSR register to variable held in the hart.
   csRegs_.regs_.at(size_t(CsrNumber::FCSR)).tie(&fcsrValue_);
 
+  // Define the hardware loop CSRs (see execLp_setup) and tie them to
+  // variables held in the hart.
+  const char* lpNames[] = { "lpstart0", "lpend0", "lpcount0",
+                            "lpstart1", "lpend1", "lpcount1" };
+  URV* lpVars[] = { &lpStart_[0], &lpEnd_[0], &lpCount_[0],
+                    &lpStart_[1], &lpEnd_[1], &lpCount_[1] };
+  for (unsigned i = 0; i < 6; ++i)
+    {
+      auto num = CsrNumber(0x7e4 + i);
+      if (defineCsr(lpNames[i], num, true, 0, ~URV(0), ~URV(0), false))
+        csRegs_.regs_.at(size_t(num)).tie(lpVars[i]);
+    }
+
+  // Same for the SHA-256 working-state CSRs (see shaRound).
+  const char* shaNames[] = { "sha_a", "sha_b", "sha_c", "sha_d",
+                             "sha_e", "sha_f", "sha_g", "sha_h" };
+  for (unsigned i = 0; i < 8; ++i)
+    {
+      auto num = CsrNumber(shaStateCsr0 + i);
+      if (defineCsr(shaNames[i], num, true, 0, ~URV(0), ~URV(0), false))
+        csRegs_.regs_.at(size_t(num)).tie(&shaState_[i]);
+    }
+
   // Configure MHARTID CSR.
   bool implemented = true, debug = false, shared = false;
   URV mask = 0, pokeMask = 0;
@@ -173,6 +197,7 @@ Hart<URV>::Hart(unsigned hartIx, URV hartId, Memory& memory)
 template <typename URV>
 Hart<URV>::~Hart()
 {
+  flushOutputBuffer();
 }
 
 
@@ -359,6 +384,7 @@ void
 Hart<URV>::updateMemoryProtection()
 {
   pmpManager_.reset();
+  fetchCheckedPage_ = ~URV(0);
 
   const unsigned count = 16;
   unsigned impCount = 0;  // Count of implemented PMP registers
@@ -511,6 +537,7 @@ Hart<URV>::updateAddressTranslation()
   virtMem_.setMode(VirtMem::Mode(mode));
   virtMem_.setAddressSpace(asid);
   virtMem_.setPageTableRootPage(ppn);
+  fetchCheckedPage_ = ~URV(0);
 
   if (asid != prevAsid)
     invalidateDecodeCache();
@@ -584,6 +611,16 @@ Hart<URV>::reset(bool resetMemoryMappedRegs)
 
   resetFloat();
 
+  // If mcustomen exists then use its bits to decide which custom
+  // instructions are enabled.
+  auto customEn = findCsr("mcustomen");
+  hasCustomEnCsr_ = customEn != nullptr;
+  if (customEn)
+    {
+      customEnCsr_ = customEn->getNumber();
+      updateCustomOpMask();
+    }
+
   // Update cached values of mstatus.mpp and mstatus.mprv and mstatus.fs.
   updateCachedMstatusFields();
 
@@ -997,82 +1034,187 @@ Hart<URV>::execAndi(const DecodedInst* di)
   intRegs_.write(di->op0(), v);
 }
 
-/* INSERT YOUR CODE FROM HERE */  
 
-template <typename URV>
-inline
-void
-Hart<URV>::execCube(const DecodedInst* di)
+/// Rotate left the given 32-bit value by n bits (used by the
+/// expressions of CustomInsts.def).
+static inline
+uint32_t
+rotl32(uint32_t x, unsigned n)
 {
-  URV v = intRegs_.read(di->op1()) * intRegs_.read(di->op1()) * intRegs_.read(di->op1());
-  intRegs_.write(di->op0(), v);
+  n &= 31;
+  return n ? (x << n) | (x >> (32 - n)) : x;
 }
 
 
-template <typename URV>
-inline
-void
-Hart<URV>::execRotleft(const DecodedInst* di)
+/// Rotate right the given 32-bit value by n bits (used by the
+/// expressions of CustomInsts.def).
+static inline
+uint32_t
+rotr32(uint32_t x, unsigned n)
 {
-  URV v = int((intRegs_.read(di->op1())) << (intRegs_.read(di->op2()))) | ((intRegs_.read(di->op1())) >> (32 - intRegs_.read(di->op2())));
-  intRegs_.write(di->op0(), v);
+  n &= 31;
+  return n ? (x >> n) | (x << (32 - n)) : x;
 }
 
-template <typename URV>
-inline
-void
-Hart<URV>::execRotright(const DecodedInst* di)
-{
-  URV v = ((intRegs_.read(di->op1())) >> (intRegs_.read(di->op2()))) | int((intRegs_.read(di->op1())) << (32 - intRegs_.read(di->op2())));
-  intRegs_.write(di->op0(), v);
-}
 
-template <typename URV>
-inline
-void
-Hart<URV>::execReverse(const DecodedInst* di)
+/// Return the given CRC32C (Castagnoli, reflected polynomial
+/// 0x82f63b78) updated with the n least significant bytes of data
+/// (least significant byte first). Used by the expressions of
+/// CustomInsts.def.
+static inline
+uint32_t
+crc32cUpdate(uint32_t crc, uint32_t data, unsigned n)
 {
-  URV v = ((intRegs_.read(di->op1())) >> (24 - 8*intRegs_.read(di->op2()))) & 0X000000ff;
-  intRegs_.write(di->op0(), v);
+  static const auto table = [] () {
+    std::array<uint32_t, 256> tab{};
+    for (uint32_t i = 0; i < 256; ++i)
+      {
+        uint32_t x = i;
+        for (unsigned j = 0; j < 8; ++j)
+          x = (x >> 1) ^ ((x & 1) ? 0x82f63b78 : 0);
+        tab.at(i) = x;
+      }
+    return tab;
+  } ();
+
+  if (n < 4)
+    data &= (uint32_t(1) << (8*n)) - 1;
+  crc ^= data;
+  for (unsigned i = 0; i < n; ++i)
+    crc = (crc >> 8) ^ table[crc & 0xff];
+  return crc;
+}
+
+
+/// Return the ith (0 to 63) SHA-256 round constant: Read-only table
+/// (ROM) used by the expressions of CustomInsts.def.
+static inline
+uint32_t
+sha256K(unsigned i)
+{
+  static const uint32_t rom[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+  return rom[i & 63];
 }
 
-template <typename URV>
-inline
-void
-Hart<URV>::execNotand(const DecodedInst* di)
-{
-  URV v = ~(intRegs_.read(di->op1())) & (intRegs_.read(di->op2()));
-  intRegs_.write(di->op0(), v);
-}
 
 template <typename URV>
-inline
-void
-Hart<URV>::execExtend1(const DecodedInst* di)
-{
-  URV v = ((intRegs_.read(di->op1()))>>3) ^ (intRegs_.read(di->op2()));
-  intRegs_.write(di->op0(), v);
-}
+URV
+Hart<URV>::shaRound(URV w, URV kIx)
+{
+  uint32_t a = shaState_[0], b = shaState_[1], c = shaState_[2];
+  uint32_t d = shaState_[3], e = shaState_[4], f = shaState_[5];
+  uint32_t g = shaState_[6], h = shaState_[7];
+
+  uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+  uint32_t ch = (e & f) ^ (~e & g);
+  uint32_t t1 = h + s1 + ch + sha256K(unsigned(kIx)) + uint32_t(w);
+  uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+  uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+  uint32_t t2 = s0 + maj;
+
+  uint32_t next[8] = { t1 + t2, a, b, c, d + t1, e, f, g };
+  for (unsigned i = 0; i < 8; ++i)
+    {
+      shaState_[i] = SRV(int32_t(next[i]));
+      recordCsrWrite(CsrNumber(shaStateCsr0 + i));
+    }
+  return shaState_[0];
+}
+
+
+// Execution methods of the custom instructions (see CustomInsts.def):
+// The value of the instruction expression is written to rd (or used
+// as the load/store address for the LDW/STW/LDM/STM forms). A disabled
+// instruction (see setCustomOpMask) is illegal.
+#define CUSTOM_EXEC_R3(expr)   intRegs_.write(di->op0(), URV(expr))
+#define CUSTOM_EXEC_R2(expr)   intRegs_.write(di->op0(), URV(expr))
+#define CUSTOM_EXEC_R3D(expr)  intRegs_.write(di->op0(), URV(expr))
+#define CUSTOM_EXEC_LDW(expr)                                           \
+  if (loadQueueEnabled_)                                                \
+    removeFromLoadQueue(di->op2(), false);                              \
+  loadAt<int32_t>(di->op0(), di->op1(), a, URV(expr))
+#define CUSTOM_EXEC_STW(expr)                                           \
+  store<uint32_t>(di->op1(), a, URV(expr), uint32_t(d))
+#define CUSTOM_EXEC_LDM(expr)                                           \
+  if (di->op2() > 7 or di->op0() + di->op2() + 1 > intRegCount())       \
+    illegalInst(di);                                                    \
+  else                                                                  \
+    loadMultiple(di->op0(), di->op1(), a, URV(expr), di->op2() + 1)
+#define CUSTOM_EXEC_STM(expr)                                           \
+  if (di->op2() > 7 or di->op0() + di->op2() + 1 > intRegCount())       \
+    illegalInst(di);                                                    \
+  else                                                                  \
+    storeMultiple(di->op0(), di->op1(), a, URV(expr), di->op2() + 1)
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+template <typename URV>                                                 \
+inline                                                                  \
+void                                                                    \
+Hart<URV>::exec##Name(const DecodedInst* di)                            \
+{                                                                       \
+  if (not isCustomOpEnabled(CustomOp::id))                              \
+    {                                                                   \
+      illegalInst(di);                                                  \
+      return;                                                           \
+    }                                                                   \
+  [[maybe_unused]] URV a = intRegs_.read(di->op1());                    \
+  [[maybe_unused]] URV b = intRegs_.read(di->op2());                    \
+  [[maybe_unused]] URV d = intRegs_.read(di->op0());                    \
+  CUSTOM_EXEC_##form(expr);                                             \
+}
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+#undef CUSTOM_EXEC_STM
+#undef CUSTOM_EXEC_LDM
+#undef CUSTOM_EXEC_STW
+#undef CUSTOM_EXEC_LDW
+#undef CUSTOM_EXEC_R3D
+#undef CUSTOM_EXEC_R2
+#undef CUSTOM_EXEC_R3
+
 
 template <typename URV>
-inline
-void
-Hart<URV>::execExtend2(const DecodedInst* di)
+int
+Hart<URV>::customOpIndex(const std::string& mnemonic)
 {
-  URV v = int(intRegs_.read(di->op1())<<2) + (intRegs_.read(di->op2())-16);
-  intRegs_.write(di->op0(), v);
+#define CUSTOM_INST(id, Name, mnem, opcode, funct7, funct3, form, expr) \
+  if (mnemonic == mnem)                                                 \
+    return int(CustomOp::id);
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+
+  if (mnemonic == "lp.setup")
+    return int(CustomOp::lp_setup);
+
+  return -1;
 }
 
+
 template <typename URV>
-inline
 void
-Hart<URV>::execExtend3(const DecodedInst* di)
+Hart<URV>::updateCustomOpMask()
 {
-  URV v = int((intRegs_.read(di->op1()))<<3) + (intRegs_.read(di->op2()));
-  intRegs_.write(di->op0(), v);
+  URV value = 0;
+  if (hasCustomEnCsr_ and peekCsr(customEnCsr_, value))
+    customOpMask_ = value;
 }
 
-/* INSERT YOUR CODE END HERE */  
 
 template <typename URV>
 bool
@@ -1265,63 +1407,55 @@ Hart<URV>::applyLoadFinished(URV addr, unsigned tag, unsigned& matches)
 
 static
 void
-printUnsignedHisto(const char* tag, const std::vector<uint64_t>& histo,
-		   FILE* file)
+printUnsignedHisto(const char* tag, const uint64_t* histo, FILE* file)
 {
-  if (histo.size() < 7)
-    return;
-
-  if (histo.at(0))
-    fprintf(file, "    %s  0          %" PRId64 "\n", tag, histo.at(0));
-  if (histo.at(1))
-    fprintf(file, "    %s  1          %" PRId64 "\n", tag, histo.at(1));
-  if (histo.at(2))
-    fprintf(file, "    %s  2          %" PRId64 "\n", tag, histo.at(2));
-  if (histo.at(3))
-    fprintf(file, "    %s  (2,   16]  %" PRId64 "\n", tag, histo.at(3));
-  if (histo.at(4))
-    fprintf(file, "    %s  (16,  1k]  %" PRId64 "\n", tag, histo.at(4));
-  if (histo.at(5))
-    fprintf(file, "    %s  (1k, 64k]  %" PRId64 "\n", tag, histo.at(5));
-  if (histo.at(6))
-    fprintf(file, "    %s  > 64k      %" PRId64 "\n", tag, histo.at(6));
+  if (histo[0])
+    fprintf(file, "    %s  0          %" PRId64 "\n", tag, histo[0]);
+  if (histo[1])
+    fprintf(file, "    %s  1          %" PRId64 "\n", tag, histo[1]);
+  if (histo[2])
+    fprintf(file, "    %s  2          %" PRId64 "\n", tag, histo[2]);
+  if (histo[3])
+    fprintf(file, "    %s  (2,   16]  %" PRId64 "\n", tag, histo[3]);
+  if (histo[4])
+    fprintf(file, "    %s  (16,  1k]  %" PRId64 "\n", tag, histo[4]);
+  if (histo[5])
+    fprintf(file, "    %s  (1k, 64k]  %" PRId64 "\n", tag, histo[5]);
+  if (histo[6])
+    fprintf(file, "    %s  > 64k      %" PRId64 "\n", tag, histo[6]);
 }
 
 
 static
 void
-printSignedHisto(const char* tag, const std::vector<uint64_t>& histo,
-		 FILE* file)
-{
-  if (histo.size() < 13)
-    return;
-
-  if (histo.at(0))
-    fprintf(file, "    %s <= -64k     %" PRId64 "\n", tag, histo.at(0));
-  if (histo.at(1))
-    fprintf(file, "    %s (-64k, -1k] %" PRId64 "\n", tag, histo.at(1));
-  if (histo.at(2))
-    fprintf(file, "    %s (-1k,  -16] %" PRId64 "\n", tag, histo.at(2));
-  if (histo.at(3))
-    fprintf(file, "    %s (-16,   -3] %" PRId64 "\n", tag, histo.at(3));
-  if (histo.at(4))
-    fprintf(file, "    %s -2          %" PRId64 "\n", tag, histo.at(4));
-  if (histo.at(5))
-    fprintf(file, "    %s -1          %" PRId64 "\n", tag, histo.at(5));
-  if (histo.at(6))
-    fprintf(file, "    %s 0           %" PRId64 "\n", tag, histo.at(6));
-  if (histo.at(7))
-    fprintf(file, "    %s 1           %" PRId64 "\n", tag, histo.at(7));
-  if (histo.at(8))
-    fprintf(file, "    %s 2           %" PRId64 "\n", tag, histo.at(8));
-  if (histo.at(9))
-    fprintf(file, "    %s (2,     16] %" PRId64 "\n", tag, histo.at(9));
-  if (histo.at(10))
-    fprintf(file, "    %s (16,    1k] %" PRId64 "\n", tag, histo.at(10));
-  if (histo.at(11))	              
-    fprintf(file, "    %s (1k,   64k] %" PRId64 "\n", tag, histo.at(11));
-  if (histo.at(12))	              
-    fprintf(file, "    %s > 64k       %" PRId64 "\n", tag, histo.at(12));
+printSignedHisto(const char* tag, const uint64_t* histo, FILE* file)
+{
+  if (histo[0])
+    fprintf(file, "    %s <= -64k     %" PRId64 "\n", tag, histo[0]);
+  if (histo[1])
+    fprintf(file, "    %s (-64k, -1k] %" PRId64 "\n", tag, histo[1]);
+  if (histo[2])
+    fprintf(file, "    %s (-1k,  -16] %" PRId64 "\n", tag, histo[2]);
+  if (histo[3])
+    fprintf(file, "    %s (-16,   -3] %" PRId64 "\n", tag, histo[3]);
+  if (histo[4])
+    fprintf(file, "    %s -2          %" PRId64 "\n", tag, histo[4]);
+  if (histo[5])
+    fprintf(file, "    %s -1          %" PRId64 "\n", tag, histo[5]);
+  if (histo[6])
+    fprintf(file, "    %s 0           %" PRId64 "\n", tag, histo[6]);
+  if (histo[7])
+    fprintf(file, "    %s 1           %" PRId64 "\n", tag, histo[7]);
+  if (histo[8])
+    fprintf(file, "    %s 2           %" PRId64 "\n", tag, histo[8]);
+  if (histo[9])
+    fprintf(file, "    %s (2,     16] %" PRId64 "\n", tag, histo[9]);
+  if (histo[10])
+    fprintf(file, "    %s (16,    1k] %" PRId64 "\n", tag, histo[10]);
+  if (histo[11])	              
+    fprintf(file, "    %s (1k,   64k] %" PRId64 "\n", tag, histo[11]);
+  if (histo[12])	              
+    fprintf(file, "    %s > 64k       %" PRId64 "\n", tag, histo[12]);
 }
 
 
@@ -1331,12 +1465,12 @@ enum class FpKinds { PosInf, NegInf, PosNormal, NegNormal, PosSubnormal, NegSubn
 
 static
 void
-printFpHisto(const char* tag, const std::vector<uint64_t>& histo, FILE* file)
+printFpHisto(const char* tag, const uint64_t* histo, FILE* file)
 {
   for (unsigned i = 0; i <= unsigned(FpKinds::SignalingNan); ++i)
     {
       FpKinds kind = FpKinds(i);
-      uint64_t freq = histo.at(i);
+      uint64_t freq = histo[i];
       if (not freq)
         continue;
 
@@ -1390,45 +1524,37 @@ template <typename URV>
 void
 Hart<URV>::reportInstructionFrequency(FILE* file) const
 {
-  struct CompareFreq
-  {
-    CompareFreq(const std::vector<InstProfile>& profileVec)
-      : profileVec(profileVec)
-    { }
-
-    bool operator()(size_t a, size_t b) const
-    { return profileVec.at(a).freq_ < profileVec.at(b).freq_; }
+  const InstProfileArena& prof = instProfiles_;
 
-    const std::vector<InstProfile>& profileVec;
-  };
-
-  std::vector<size_t> indices(instProfileVec_.size());
+  std::vector<size_t> indices(prof.size());
   for (size_t i = 0; i < indices.size(); ++i)
     indices.at(i) = i;
-  std::sort(indices.begin(), indices.end(), CompareFreq(instProfileVec_));
+  std::sort(indices.begin(), indices.end(), [&prof] (size_t a, size_t b) {
+      return prof.freq(InstId(a)) < prof.freq(InstId(b)); });
 
   for (auto profIx : indices)
     {
       InstId id = InstId(profIx);
 
       const InstEntry& entry = instTable_.getEntry(id);
-      const InstProfile& prof = instProfileVec_.at(profIx);
-      uint64_t freq = prof.freq_;
+      uint64_t freq = prof.freq(id);
       if (not freq)
 	continue;
 
       fprintf(file, "%s %" PRId64 "\n", entry.name().c_str(), freq);
 
-      auto regCount = intRegCount();
+      auto regCount = prof.regCount();
 
+      const uint64_t* destFreq = prof.destRegFreq(id);
       uint64_t count = 0;
-      for (auto n : prof.destRegFreq_) count += n;
+      for (unsigned i = 0; i < regCount; ++i)
+        count += destFreq[i];
       if (count)
 	{
 	  fprintf(file, "  +rd");
 	  for (unsigned i = 0; i < regCount; ++i)
-	    if (prof.destRegFreq_.at(i))
-	      fprintf(file, " %d:%" PRId64, i, prof.destRegFreq_.at(i));
+	    if (destFreq[i])
+	      fprintf(file, " %d:%" PRId64, i, destFreq[i]);
 	  fprintf(file, "\n");
 	}
 
@@ -1438,21 +1564,22 @@ Hart<URV>::reportInstructionFrequency(FILE* file) const
         {
           if (entry.ithOperandMode(opIx) == OperandMode::Read and
               (entry.ithOperandType(opIx) == OperandType::IntReg or
-               entry.ithOperandType(opIx) == OperandType::FpReg))
+               entry.ithOperandType(opIx) == OperandType::FpReg) and
+              srcIx < prof.maxSources)
             {
+              const uint64_t* regFreq = prof.srcRegFreq(id, srcIx);
               uint64_t count = 0;
-              for (auto n : prof.srcRegFreq_.at(srcIx))
-                count += n;
+              for (unsigned i = 0; i < regCount; ++i)
+                count += regFreq[i];
               if (count)
                 {
-                  const auto& regFreq = prof.srcRegFreq_.at(srcIx);
                   fprintf(file, "  +rs%d", srcIx + 1);
                   for (unsigned i = 0; i < regCount; ++i)
-                    if (regFreq.at(i))
-                      fprintf(file, " %d:%" PRId64, i, regFreq.at(i));
+                    if (regFreq[i])
+                      fprintf(file, " %d:%" PRId64, i, regFreq[i]);
                   fprintf(file, "\n");
 
-                  const auto& histo = prof.srcHisto_.at(srcIx);
+                  const uint64_t* histo = prof.srcHisto(id, srcIx);
                   std::string tag = std::string("+hist") + std::to_string(srcIx + 1);
                   if (entry.ithOperandType(opIx) == OperandType::FpReg)
                     printFpHisto(tag.c_str(), histo, file);
@@ -1466,18 +1593,18 @@ Hart<URV>::reportInstructionFrequency(FILE* file) const
             }
 	}
 
-      if (prof.hasImm_)
+      if (prof.hasImm(id))
 	{
-	  fprintf(file, "  +imm  min:%d max:%d\n", prof.minImm_, prof.maxImm_);
-	  printSignedHisto("+hist ", prof.srcHisto_.back(), file);
+	  fprintf(file, "  +imm  min:%d max:%d\n", prof.minImm(id), prof.maxImm(id));
+	  printSignedHisto("+hist ", prof.immHisto(id), file);
 	}
 
-      if (prof.user_)
-        fprintf(file, "  +user %" PRIu64 "\n", prof.user_);
-      if (prof.supervisor_)
-        fprintf(file, "  +supervisor %" PRIu64 "\n", prof.supervisor_);
-      if (prof.machine_)
-        fprintf(file, "  +machine %" PRIu64 "\n", prof.machine_);
+      if (prof.user(id))
+        fprintf(file, "  +user %" PRIu64 "\n", prof.user(id));
+      if (prof.supervisor(id))
+        fprintf(file, "  +supervisor %" PRIu64 "\n", prof.supervisor(id));
+      if (prof.machine(id))
+        fprintf(file, "  +machine %" PRIu64 "\n", prof.machine(id));
     }
 }
 
@@ -1635,6 +1762,259 @@ Hart<URV>::reportLrScStat(FILE* file) const
 }
 
 
+/// Bucket labels of the signed histograms (see printSignedHisto).
+static const std::vector<std::string> signedHistoLabels =
+  { "<=-64k", "(-64k,-1k]", "(-1k,-16]", "(-16,-3]", "-2", "-1", "0", "1", "2",
+    "(2,16]", "(16,1k]", "(1k,64k]", ">64k" };
+
+/// Bucket labels of the unsigned histograms (see printUnsignedHisto).
+static const std::vector<std::string> unsignedHistoLabels =
+  { "0", "1", "2", "(2,16]", "(16,1k]", "(1k,64k]", ">64k" };
+
+/// Bucket labels of the floating point histograms (see printFpHisto).
+static const std::vector<std::string> fpHistoLabels =
+  { "pos_inf", "neg_inf", "pos_normal", "neg_normal", "pos_subnormal",
+    "neg_subnormal", "pos_zero", "neg_zero", "quiet_nan", "signaling_nan" };
+
+
+/// Return a vector of the decimal representations of 0 to n-1.
+static std::vector<std::string>
+indexLabels(size_t n)
+{
+  std::vector<std::string> labels;
+  for (size_t i = 0; i < n; ++i)
+    labels.push_back(std::to_string(i));
+  return labels;
+}
+
+
+template <typename URV>
+void
+Hart<URV>::defineFixedStats()
+{
+  StatsRegistry& reg = stats_;
+
+  // Run stats.
+  reg.addCounter("run.instructions", [this]() { return instCounter_; });
+  reg.addCounter("run.retired", [this]() { return retiredInsts_; });
+  reg.addCounter("run.cycles", [this]() { return cycleCount_; });
+  reg.addCounter("run.last.instructions", [this]() { return lastRunInsts_; });
+  reg.addValue("run.last.seconds", [this]() { return lastRunSeconds_; });
+  reg.addValue("run.last.inst_per_sec", [this]() {
+      return lastRunSeconds_ > 0 ? double(lastRunInsts_) / lastRunSeconds_ : 0.0; });
+
+  // Trap stats: Interrupts indexed by cause, exceptions by cause and
+  // secondary cause.
+  reg.addCounter("trap.interrupts", [this]() { return interruptCount_; });
+  reg.addCounter("trap.nmis", [this]() { return nmiCount_; });
+  reg.addCounter("trap.exceptions", [this]() { return exceptionCount_; });
+  reg.addHistogram("trap.interrupt", indexLabels(interruptStat_.size()),
+                   [this](std::vector<uint64_t>& counts) {
+      for (size_t i = 0; i < counts.size() and i < interruptStat_.size(); ++i)
+        counts.at(i) = interruptStat_.at(i);
+    });
+  for (size_t cause = 0; cause < exceptionStat_.size(); ++cause)
+    {
+      std::string tag = "trap.exception." + std::to_string(cause);
+      reg.addHistogram(tag, indexLabels(exceptionStat_.at(cause).size()),
+                       [this, cause](std::vector<uint64_t>& counts) {
+          const auto& secCauseVec = exceptionStat_.at(cause);
+          for (size_t i = 0; i < counts.size() and i < secCauseVec.size(); ++i)
+            counts.at(i) = secCauseVec.at(i);
+        });
+    }
+
+  // Load-reserve/store-conditional stats.
+  reg.addCounter("lrsc.lr", [this]() { return lrCount_; });
+  reg.addCounter("lrsc.lr_success", [this]() { return lrSuccess_; });
+  reg.addCounter("lrsc.sc", [this]() { return scCount_; });
+  reg.addCounter("lrsc.sc_success", [this]() { return scSuccess_; });
+
+  // Physical memory protection: Checks and denials by access type,
+  // and the per-entry report of the PMP manager.
+  const char* pmpNames[] = { "read", "write", "exec" };
+  for (unsigned kind = PmpRead; kind <= PmpExec; ++kind)
+    {
+      std::string tag = std::string("pmp.") + pmpNames[kind];
+      reg.addCounter(tag + ".checks", [this, kind]() { return pmpChecks_.at(kind); });
+      reg.addCounter(tag + ".denied", [this, kind]() { return pmpDenied_.at(kind); });
+    }
+  reg.addText("pmp.report", [this]() {
+      std::ostringstream oss;
+      pmpManager_.printStats(oss);
+      return oss.str(); });
+
+  // Implemented performance counters.
+  for (unsigned ix = 3; ix <= 31; ++ix)
+    {
+      auto lowCsr = CsrNumber(unsigned(CsrNumber::MHPMCOUNTER3) + ix - 3);
+      auto highCsr = CsrNumber(unsigned(CsrNumber::MHPMCOUNTER3H) + ix - 3);
+      URV value = 0;
+      if (not peekCsr(lowCsr, value))
+        continue;
+      std::string name = "perf.mhpmcounter" + std::to_string(ix);
+      reg.addCounter(name, [this, lowCsr, highCsr]() {
+          URV low = 0, high = 0;
+          peekCsr(lowCsr, low);
+          if constexpr (sizeof(URV) == 4)
+            {
+              peekCsr(highCsr, high);
+              return (uint64_t(high) << 32) | low;
+            }
+          return uint64_t(low);
+        });
+    }
+}
+
+
+template <typename URV>
+void
+Hart<URV>::defineStats()
+{
+  StatsRegistry& reg = stats_;
+
+  if (not statsDefined_)
+    {
+      statsDefined_ = true;
+      defineFixedStats();
+    }
+
+  // Optional statistics: Register again if their options changed.
+  unsigned layout = (instProfiles_.empty()? 0 : 1) | (enableEnergy_? 2 : 0);
+  if (layout == statsLayout_)
+    return;
+  statsLayout_ = layout;
+  reg.removePrefix("inst.");
+  reg.removePrefix("energy.");
+
+  // Instruction frequency stats. Only the frequencies go into the
+  // snapshots: The histograms would make those too large.
+  if (not instProfiles_.empty())
+    {
+      const InstProfileArena& prof = instProfiles_;
+      auto regLabels = indexLabels(prof.regCount());
+
+      for (size_t ix = 0; ix < prof.size(); ++ix)
+        {
+          InstId id = InstId(ix);
+          const InstEntry& entry = instTable_.getEntry(id);
+          if (entry.name().empty())
+            continue;
+          std::string tag = "inst." + entry.name();
+
+          reg.addCounter(tag + ".freq", [this, id]() {
+              return instProfiles_.empty() ? 0 : instProfiles_.freq(id); });
+          reg.addCounter(tag + ".user", [this, id]() {
+              return instProfiles_.empty() ? 0 : instProfiles_.user(id); }, false);
+          reg.addCounter(tag + ".supervisor", [this, id]() {
+              return instProfiles_.empty() ? 0 : instProfiles_.supervisor(id); }, false);
+          reg.addCounter(tag + ".machine", [this, id]() {
+              return instProfiles_.empty() ? 0 : instProfiles_.machine(id); }, false);
+
+          reg.addHistogram(tag + ".rd", regLabels, [this, id](std::vector<uint64_t>& counts) {
+              if (instProfiles_.empty())
+                return;
+              const uint64_t* freq = instProfiles_.destRegFreq(id);
+              for (size_t i = 0; i < counts.size(); ++i)
+                counts.at(i) = freq[i];
+            }, false);
+
+          unsigned srcIx = 0;
+          for (unsigned opIx = 0; opIx < entry.operandCount(); ++opIx)
+            {
+              OperandType type = entry.ithOperandType(opIx);
+              if (entry.ithOperandMode(opIx) != OperandMode::Read or
+                  (type != OperandType::IntReg and type != OperandType::FpReg) or
+                  srcIx >= prof.maxSources)
+                continue;
+
+              std::string srcTag = tag + ".rs" + std::to_string(srcIx + 1);
+              reg.addHistogram(srcTag, regLabels, [this, id, srcIx](std::vector<uint64_t>& counts) {
+                  if (instProfiles_.empty())
+                    return;
+                  const uint64_t* freq = instProfiles_.srcRegFreq(id, srcIx);
+                  for (size_t i = 0; i < counts.size(); ++i)
+                    counts.at(i) = freq[i];
+                }, false);
+
+              const auto& histoLabels = (type == OperandType::FpReg ? fpHistoLabels :
+                                         entry.isUnsigned() ? unsignedHistoLabels :
+                                         signedHistoLabels);
+              std::string histoTag = tag + ".hist" + std::to_string(srcIx + 1);
+              reg.addHistogram(histoTag, histoLabels, [this, id, srcIx](std::vector<uint64_t>& counts) {
+                  if (instProfiles_.empty())
+                    return;
+                  const uint64_t* histo = instProfiles_.srcHisto(id, srcIx);
+                  for (size_t i = 0; i < counts.size(); ++i)
+                    counts.at(i) = histo[i];
+                }, false);
+
+              srcIx++;
+            }
+
+          reg.addHistogram(tag + ".imm", signedHistoLabels, [this, id](std::vector<uint64_t>& counts) {
+              if (instProfiles_.empty())
+                return;
+              const uint64_t* histo = instProfiles_.immHisto(id);
+              for (size_t i = 0; i < counts.size(); ++i)
+                counts.at(i) = histo[i];
+            }, false);
+        }
+    }
+
+  // Energy estimate.
+  if (enableEnergy_)
+    {
+      reg.addValue("energy.total", [this]() { return energyModel_.totalEnergy(); });
+      reg.addValue("energy.memory", [this]() { return energyModel_.memoryEnergy(); });
+      reg.addCounter("energy.instructions", [this]() { return energyModel_.instCount(); });
+    }
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::loadEnergyTable(const std::string& path)
+{
+  if (not energyModel_.loadTable(path, instTable_))
+    return false;
+
+  energyModel_.setFunctionLookup([this] (uint64_t addr, std::string& name,
+                                         uint64_t& start, uint64_t& size) {
+      ElfSymbol sym;
+      if (not findElfFunction(addr, name, sym))
+        return false;
+      start = sym.addr_;
+      size = sym.size_;
+      return true;
+    });
+
+  enableEnergy_ = true;
+  return true;
+}
+
+
+template <typename URV>
+void
+Hart<URV>::dumpStats(FILE* file, StatsRegistry::Format format)
+{
+  defineStats();
+  materializePerfCounters();
+  stats_.dump(file, format);
+}
+
+
+template <typename URV>
+void
+Hart<URV>::takeStatsSnapshot()
+{
+  defineStats();
+  materializePerfCounters();
+  stats_.dumpSnapshot(statsSnapFile_, statsSnapFormat_, instCounter_);
+  nextStatsSnap_ = instCounter_ + statsSnapInterval_;
+}
+
+
 template <typename URV>
 ExceptionCause
 Hart<URV>::determineMisalLoadException(URV addr, unsigned accessSize,
@@ -1941,9 +2321,11 @@ Hart<URV>::determineLoadException(unsigned rs1, URV base, uint64_t& addr,
   if (pmpEnabled_)
     {
       Pmp pmp = pmpManager_.accessPmp(addr);
+      pmpChecks_[PmpRead]++;
       if (not pmp.isRead(privMode_, mstatusMpp_, mstatusMprv_) and
           not isAddrMemMapped(addr))
         {
+          pmpDenied_[PmpRead]++;
           secCause = SecondaryCause::LOAD_ACC_PMP;
           return ExceptionCause::LOAD_ACC_FAULT;
         }
@@ -1994,12 +2376,20 @@ inline
 bool
 Hart<URV>::load(uint32_t rd, uint32_t rs1, int32_t imm)
 {
-#ifdef FAST_SLOPPY
-  return fastLoad<LOAD_TYPE>(rd, rs1, imm);
-#else
+  if (sloppyMem_)
+    return fastLoad<LOAD_TYPE>(rd, rs1, imm);
 
   URV base = intRegs_.read(rs1);
-  uint64_t virtAddr = base + SRV(imm);
+  return loadAt<LOAD_TYPE>(rd, rs1, base, URV(base + SRV(imm)));
+}
+
+
+template <typename URV>
+template <typename LOAD_TYPE>
+inline
+bool
+Hart<URV>::loadAt(uint32_t rd, uint32_t rs1, URV base, uint64_t virtAddr)
+{
   unsigned ldSize = sizeof(LOAD_TYPE);
 
   ldStAddr_ = virtAddr;   // For reporting ld/st addr in trace-mode.
@@ -2035,7 +2425,9 @@ Hart<URV>::load(uint32_t rd, uint32_t rs1, int32_t imm)
   // Loading from console-io does a standard input read.
   if (conIoValid_ and addr == conIo_ and enableConIn_ and not triggerTripped_)
     {
-      SRV val = fgetc(stdin);
+      if (bufferOutput_)
+        flushOutputBuffer();  // Make prompts visible before blocking.
+      SRV val = readConsoleInput();
       intRegs_.write(rd, val);
       return true;
     }
@@ -2085,7 +2477,6 @@ Hart<URV>::load(uint32_t rd, uint32_t rs1, int32_t imm)
 
   assert(0);
   return false;
-#endif
 }
 
 
@@ -2114,6 +2505,9 @@ bool
 Hart<URV>::fastStore(uint32_t /*rs1*/, URV /*base*/, URV addr,
                      STORE_TYPE storeVal)
 {
+  if (revInterval_)
+    saveCheckpointPages(addr, sizeof(STORE_TYPE));
+
   if (memory_.write(hartIx_, addr, storeVal))
     {
       if (toHostValid_ and addr == toHost_ and storeVal != 0)
@@ -2136,9 +2530,8 @@ inline
 bool
 Hart<URV>::store(uint32_t rs1, URV base, URV virtAddr, STORE_TYPE storeVal)
 {
-#ifdef FAST_SLOPPY
-  return fastStore(rs1, base, virtAddr, storeVal);
-#else
+  if (sloppyMem_)
+    return fastStore(rs1, base, virtAddr, storeVal);
 
   std::lock_guard<std::mutex> lock(memory_.lrMutex_);
 
@@ -2185,6 +2578,9 @@ Hart<URV>::store(uint32_t rs1, URV base, URV virtAddr, STORE_TYPE storeVal)
   if (wideLdSt_)
     return wideStore(addr, storeVal);
 
+  if (revInterval_)
+    saveCheckpointPages(addr, stSize);
+
   if (memory_.write(hartIx_, addr, storeVal))
     {
       memory_.invalidateOtherHartLr(hartIx_, addr, stSize);
@@ -2198,14 +2594,23 @@ Hart<URV>::store(uint32_t rs1, URV base, URV virtAddr, STORE_TYPE storeVal)
 			      toHost_, storeVal);
 	}
 
-      // If addr is special location, then write to console.
+      // If addr is special location, then write to console (unless
+      // re-executed by a reverse execution replay: Already written).
       if (conIoValid_ and addr == conIo_)
         {
-          if (consoleOut_)
+          if (consoleOut_ and not isReExecuting())
             {
-              fputc(storeVal, consoleOut_);
-              if (storeVal == '\n')
-                fflush(consoleOut_);
+              if (bufferOutput_)
+                {
+                  char byte = char(storeVal);
+                  bufferOutput(consoleOut_, &byte, 1);
+                }
+              else
+                {
+                  fputc(storeVal, consoleOut_);
+                  if (storeVal == '\n')
+                    fflush(consoleOut_);
+                }
             }
           return true;
 	}
@@ -2219,7 +2624,155 @@ Hart<URV>::store(uint32_t rs1, URV base, URV virtAddr, STORE_TYPE storeVal)
   // Store failed: Take exception. Should not happen but we are paranoid.
   initiateStoreException(ExceptionCause::STORE_ACC_FAULT, virtAddr, secCause);
   return false;
-#endif
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::loadMultiple(uint32_t rd, uint32_t rs1, URV base, uint64_t virtAddr,
+                        unsigned count)
+{
+  assert(count >= 1 and count <= 8 and rd + count <= intRegCount());
+
+  ldStAddr_ = virtAddr;   // For reporting ld/st addr in trace-mode.
+  ldStAddrValid_ = true;  // For reporting ld/st addr in trace-mode.
+
+  if (loadQueueEnabled_)
+    removeFromLoadQueue(rs1, false);
+
+  // Check the whole range before reading anything: On a fault, the
+  // exception reports the address of the faulting word and no register
+  // is modified (the instruction can be restarted after the trap).
+  bool hasTrig = hasActiveTrigger();
+  uint64_t addrs[8];
+  for (unsigned i = 0; i < count; ++i)
+    {
+      uint64_t va = virtAddr + 4*i;
+      if (hasTrig and ldStAddrTriggerHit(va, TriggerTiming::Before,
+                                         true /*isLoad*/, privMode_,
+                                         isInterruptEnabled()))
+        triggerTripped_ = true;
+
+      auto secCause = SecondaryCause::NONE;
+      addrs[i] = va;
+      auto cause = determineLoadException(rs1, base, addrs[i], 4, secCause);
+      if (cause != ExceptionCause::NONE)
+        {
+          if (triggerTripped_)
+            return false;
+          initiateLoadException(cause, va, secCause);
+          return false;
+        }
+    }
+  if (triggerTripped_)
+    return false;
+
+  uint32_t vals[8];
+  for (unsigned i = 0; i < count; ++i)
+    {
+      if (not memory_.read(addrs[i], vals[i]))
+        {
+          // Should not happen: range was checked above.
+          auto secCause = SecondaryCause::NONE;
+          initiateLoadException(ExceptionCause::LOAD_ACC_FAULT,
+                                virtAddr + 4*i, secCause);
+          return false;
+        }
+
+      if (hasTrig and (isAddrIdempotent(addrs[i]) or
+                       isAddrMemMapped(addrs[i]) or isAddrInDccm(addrs[i])))
+        if (ldStDataTriggerHit(vals[i], TriggerTiming::Before, true /*isLoad*/,
+                               privMode_, isInterruptEnabled()))
+          triggerTripped_ = true;
+    }
+  if (triggerTripped_)
+    return false;
+
+  // One load-queue entry per register so that an imprecise load error
+  // on any of the words restores the corresponding register.
+  for (unsigned i = 0; i < count; ++i)
+    {
+      if (loadQueueEnabled_)
+        putInLoadQueue(4, addrs[i], rd + i, peekIntReg(rd + i));
+      intRegs_.write(rd + i, SRV(int32_t(vals[i])));
+    }
+  return true;
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::storeMultiple(uint32_t rs, uint32_t rs1, URV base, uint64_t virtAddr,
+                         unsigned count)
+{
+  assert(count >= 1 and count <= 8 and rs + count <= intRegCount());
+
+  std::lock_guard<std::mutex> lock(memory_.lrMutex_);
+
+  ldStAddr_ = virtAddr;   // For reporting ld/st addr in trace-mode.
+  ldStAddrValid_ = true;  // For reporting ld/st addr in trace-mode.
+
+  // Check the whole range before writing anything: On a fault, the
+  // exception reports the address of the faulting word and memory is
+  // not modified.
+  bool hasTrig = hasActiveTrigger();
+  TriggerTiming timing = TriggerTiming::Before;
+  bool isLd = false;  // Not a load.
+  uint64_t addrs[8];
+  uint32_t vals[8];
+  for (unsigned i = 0; i < count; ++i)
+    {
+      uint64_t va = virtAddr + 4*i;
+      if (hasTrig and ldStAddrTriggerHit(va, timing, isLd, privMode_,
+                                         isInterruptEnabled()))
+        triggerTripped_ = true;
+
+      vals[i] = uint32_t(intRegs_.read(rs + i));
+      uint32_t maskedVal = vals[i];
+      auto secCause = SecondaryCause::NONE;
+      addrs[i] = va;
+      bool forcedFail = false;
+      ExceptionCause cause = determineStoreException(rs1, base, addrs[i],
+                                                     maskedVal, secCause,
+                                                     forcedFail);
+      if (hasTrig and cause == ExceptionCause::NONE and
+          ldStDataTriggerHit(maskedVal, timing, isLd, privMode_,
+                             isInterruptEnabled()))
+        triggerTripped_ = true;
+      if (triggerTripped_)
+        return false;
+
+      if (cause != ExceptionCause::NONE)
+        {
+          initiateStoreException(cause, va, secCause);
+          return false;
+        }
+    }
+
+  for (unsigned i = 0; i < count; ++i)
+    {
+      uint64_t addr = addrs[i];
+      if (revInterval_)
+        saveCheckpointPages(addr, 4);
+      if (not memory_.write(hartIx_, addr, vals[i]))
+        {
+          // Should not happen: range was checked above.
+          auto secCause = SecondaryCause::NONE;
+          initiateStoreException(ExceptionCause::STORE_ACC_FAULT,
+                                 virtAddr + 4*i, secCause);
+          return false;
+        }
+      memory_.invalidateOtherHartLr(hartIx_, addr, 4);
+      invalidateDecodeCache(virtAddr + 4*i, 4);
+
+      if (toHostValid_ and addr == toHost_ and vals[i] != 0)
+        throw CoreException(CoreException::Stop, "write to to-host",
+                            toHost_, vals[i]);
+
+      if (addr >= clintStart_ and addr <= clintLimit_)
+        processClintWrite(addr, 4, vals[i]);
+    }
+  return true;
 }
 
 
@@ -2569,8 +3122,10 @@ Hart<URV>::fetchInst(URV virtAddr, uint32_t& inst)
       if (pmpEnabled_)
         {
           Pmp pmp = pmpManager_.accessPmp(addr);
+          pmpChecks_[PmpExec]++;
           if (not pmp.isExec(privMode_, mstatusMpp_, instMprv))
             {
+              pmpDenied_[PmpExec]++;
               if (triggerTripped_)
                 return false;
               auto secCause = SecondaryCause::INST_PMP;
@@ -2601,8 +3156,10 @@ Hart<URV>::fetchInst(URV virtAddr, uint32_t& inst)
   if (pmpEnabled_)
     {
       Pmp pmp = pmpManager_.accessPmp(addr);
+      pmpChecks_[PmpExec]++;
       if (not pmp.isExec(privMode_, mstatusMpp_, instMprv))
         {
+          pmpDenied_[PmpExec]++;
           if (triggerTripped_)
             return false;
           auto secCause = SecondaryCause::INST_PMP;
@@ -2653,8 +3210,10 @@ Hart<URV>::fetchInst(URV virtAddr, uint32_t& inst)
   if (pmpEnabled_)
     {
       Pmp pmp = pmpManager_.accessPmp(addr);
+      pmpChecks_[PmpExec]++;
       if (not pmp.isExec(privMode_, mstatusMpp_, instMprv))
         {
+          pmpDenied_[PmpExec]++;
           if (triggerTripped_)
             return false;
 
@@ -3182,6 +3741,9 @@ Hart<URV>::pokeCsr(CsrNumber csr, URV val)
       return true;
     }
 
+  if (perfPending_)
+    materializePerfCounters();
+
   // Some/all bits of some CSRs are read only to CSR instructions but
   // are modifiable. Use the poke method (instead of write) to make
   // sure modifiable value are changed.
@@ -3192,8 +3754,11 @@ Hart<URV>::pokeCsr(CsrNumber csr, URV val)
   // event reg is poked.
   if (enableCounters_)
     if (csr >= CsrNumber::MHPMEVENT3 and csr <= CsrNumber::MHPMEVENT31)
-      if (not csRegs_.applyPerfEventAssign())
-        std::cerr << "Unexpected applyPerfAssign fail\n";
+      {
+        if (not csRegs_.applyPerfEventAssign())
+          std::cerr << "Unexpected applyPerfAssign fail\n";
+        definePerfLdStEvents();
+      }
 
   if (csr == CsrNumber::DCSR)
     {
@@ -3215,6 +3780,8 @@ Hart<URV>::pokeCsr(CsrNumber csr, URV val)
     updateAddressTranslation();
   else if (csr == CsrNumber::FCSR or csr == CsrNumber::FRM or csr == CsrNumber::FFLAGS)
     markFsDirty();   // Update FS field of MSTATS if FCSR is written
+  else if (hasCustomEnCsr_ and csr == customEnCsr_)
+    updateCustomOpMask();
 
   // Update cached values of MSTATUS MPP and MPRV.
   if (csr == CsrNumber::MSTATUS or csr == CsrNumber::SSTATUS)
@@ -3674,131 +4241,365 @@ template <typename URV>
 bool
 Hart<URV>::redirectOutputDescriptor(int fd, const std::string& path)
 {
+  if (fd >= 0 and fd < 32)
+    redirectedFds_ |= 1u << fd;
   return syscall_.redirectOutputDescriptor(fd, path);
 }
 
 
 template <typename URV>
-bool
-Hart<URV>::cancelLastDiv()
+void
+Hart<URV>::flushOutputBuffer()
 {
-  if (not hasLastDiv_)
-    return false;
+  if (outBuf_.empty())
+    return;
 
-  hasLastDiv_ = false;
-  return pokeIntReg(lastDivRd_, priorDivRdVal_);
+  fwrite(outBuf_.data(), 1, outBuf_.size(), outBufFile_);
+  fflush(outBufFile_);
+  outBuf_.clear();
 }
 
 
-
 template <typename URV>
 void
-Hart<URV>::undoForTrigger()
+Hart<URV>::bufferOutput(FILE* out, const char* data, size_t size)
 {
-  unsigned regIx = 0;
-  URV value = 0;
-  if (intRegs_.getLastWrittenReg(regIx, value))
+  if (out != outBufFile_)
     {
-      pokeIntReg(regIx, value);
-      intRegs_.clearLastWrittenReg();
+      flushOutputBuffer();   // Preserve order of output to different streams.
+      outBufFile_ = out;
     }
 
-  uint64_t fpVal = 0;
-  if (fpRegs_.getLastWrittenReg(regIx, fpVal))
+  outBuf_.append(data, size);
+  if (outBuf_.size() < outBufLimit_)
+    return;
+
+  // Flush up to and including the last newline keeping the trailing
+  // partial line buffered unless it is itself too long.
+  size_t pos = outBuf_.rfind('\n');
+  if (pos == std::string::npos or outBuf_.size() - pos > outBufLimit_)
     {
-      pokeFpReg(regIx, fpVal);
-      fpRegs_.clearLastWrittenReg();
+      flushOutputBuffer();
+      return;
     }
 
-  setPc(currPc_);
+  fwrite(outBuf_.data(), 1, pos + 1, out);
+  fflush(out);
+  outBuf_.erase(0, pos + 1);
 }
 
 
-void
-addToSignedHistogram(std::vector<uint64_t>& histo, int64_t val)
+template <typename URV>
+bool
+Hart<URV>::bufferWriteSyscall()
 {
-  if (histo.size() < 13)
-    histo.resize(13);
+  // Guest buffer address would need translation.
+  if (isRvs() and privMode_ != PrivilegeMode::Machine)
+    return false;
 
-  if (val < 0)
-    {
-      if      (val <= -64*1024) histo.at(0)++;
-      else if (val <= -1024)    histo.at(1)++;
-      else if (val <= -16)      histo.at(2)++;
-      else if (val < -2)        histo.at(3)++;
-      else if (val == -2)       histo.at(4)++;
-      else if (val == -1)       histo.at(5)++;
-    }
-  else
+  URV num = intRegs_.read(RegA7), fd = intRegs_.read(RegA0);
+  if (num != 64 or (fd != 1 and fd != 2) or ((redirectedFds_ >> fd) & 1))
+    return false;  // Not a write to stdout/stderr.
+
+  uint64_t addr = intRegs_.read(RegA1), count = intRegs_.read(RegA2);
+  if (addr + count < addr or addr + count > memory_.size())
+    return false;  // Let the emulator report the error.
+
+  std::string data(count, '\0');
+  for (uint64_t i = 0; i < count; ++i)
     {
-      if      (val == 0)       histo.at(6)++;
-      else if (val == 1)       histo.at(7)++;
-      else if (val == 2)       histo.at(8)++;
-      else if (val <= 16)      histo.at(9)++;
-      else if (val <= 1024)    histo.at(10)++;
-      else if (val <= 64*1024) histo.at(11)++;
-      else                     histo.at(12)++;
+      uint8_t byte = 0;
+      memory_.peek(addr + i, byte, false);
+      data.at(i) = char(byte);
     }
+
+  bufferOutput(fd == 1 ? stdout : stderr, data.data(), data.size());
+  intRegs_.write(RegA0, count);
+  return true;
 }
 
 
-void
-addToUnsignedHistogram(std::vector<uint64_t>& histo, uint64_t val)
+template <typename URV>
+bool
+Hart<URV>::fastSyscall(URV& ret)
 {
-  if (histo.size() < 13)
-    histo.resize(13);
+  // Guest buffer address would need translation.
+  if (isRvs() and privMode_ != PrivilegeMode::Machine)
+    return false;
+
+  URV num = intRegs_.read(RegA7), fd = intRegs_.read(RegA0);
+  bool isRead = num == 63 or num == 67;
+  bool isPos = num == 67 or num == 68;
+  if (not isRead and num != 64 and num != 68)
+    return false;
+
+  // The standard streams (not redirected) and the files opened by the
+  // system call emulator use the same descriptor on the host. The
+  // positional calls fail on the standard streams (ttys and pipes):
+  // Leave them to the emulator.
+  bool isFile = hostFds_.count(fd) != 0;
+  if (not isFile and (isPos or fd > 2 or ((redirectedFds_ >> fd) & 1)))
+    return false;
+
+  uint64_t addr = intRegs_.read(RegA1), count = intRegs_.read(RegA2);
+  off_t offset = off_t(SRV(intRegs_.read(RegA3)));
+  if (addr + count < addr or addr + count > memory_.size())
+    return false;  // Let the emulator report the error.
+
+  if (syscallBuf_.empty())
+    syscallBuf_.resize(64*1024);
+
+  // A read is one host call (it may block if repeated). A write is
+  // repeated until complete or failed.
+  int64_t total = 0;
+  while (count)
+    {
+      size_t chunk = std::min(count, uint64_t(syscallBuf_.size()));
+      ssize_t n = 0;
+      if (isRead)
+        {
+          n = isPos? ::pread(fd, syscallBuf_.data(), chunk, offset) :
+            ::read(fd, syscallBuf_.data(), chunk);
+          if (n > 0)
+            copyToGuest(addr, syscallBuf_.data(), n);
+        }
+      else
+        {
+          if (not isFile)
+            {
+              // Keep order with buffered output and host stdio.
+              flushOutputBuffer();
+              fflush(fd == 1 ? stdout : stderr);
+            }
+          copyFromGuest(addr, syscallBuf_.data(), chunk);
+          n = isPos? ::pwrite(fd, syscallBuf_.data(), chunk, offset) :
+            ::write(fd, syscallBuf_.data(), chunk);
+        }
+
+      if (n < 0)
+        {
+          if (total == 0)
+            total = -errno;
+          break;
+        }
+      total += n;
+      if (isRead or n == 0)
+        break;
+      addr += n;
+      offset += n;
+      count -= n;
+    }
 
-  if      (val == 0)       histo.at(0)++;
-  else if (val == 1)       histo.at(1)++;
-  else if (val == 2)       histo.at(2)++;
-  else if (val <= 16)      histo.at(3)++;
-  else if (val <= 1024)    histo.at(4)++;
-  else if (val <= 64*1024) histo.at(5)++;
-  else                     histo.at(6)++;
+  ret = SRV(total);
+  return true;
 }
 
 
-extern bool
-mostSignificantFractionBit(float x);
+template <typename URV>
+URV
+Hart<URV>::hostSyscall()
+{
+  URV ret = 0;
+  if (fastSyscall(ret))
+    return ret;
+
+  URV num = intRegs_.read(RegA7), a0 = intRegs_.read(RegA0);
+  if (num == 57)  // close
+    hostFds_.erase(a0);
 
+  ret = syscall_.emulate();
 
-extern bool
-mostSignificantFractionBit(double x);
+  if (num == 56)  // openat
+    noteHostFd(ret, SRV(a0), intRegs_.read(RegA1));
+  else if (num == 1024)  // open (newlib)
+    noteHostFd(ret, AT_FDCWD, a0);
+  return ret;
+}
 
 
-template <typename FP_TYPE>
+template <typename URV>
 void
-addToFpHistogram(std::vector<uint64_t>& histo, FP_TYPE val)
+Hart<URV>::noteHostFd(URV fd, SRV dirFd, uint64_t pathAddr)
 {
-  bool pos = not std::signbit(val);
-  int type = std::fpclassify(val);
+  if (SRV(fd) <= 2)
+    return;  // Failed or standard stream.
 
-  if (type == FP_INFINITE)
+  std::string path;
+  for (uint64_t addr = pathAddr; path.size() < PATH_MAX; ++addr)
     {
-      FpKinds kind = pos? FpKinds::PosInf : FpKinds::NegInf;
-      histo.at(unsigned(kind))++;
+      uint8_t byte = 0;
+      if (not memory_.peek(addr, byte, false) or byte == 0)
+        break;
+      path.push_back(char(byte));
     }
-  else if (type == FP_NORMAL)
+  if (path.empty() or (path.front() != '/' and dirFd != AT_FDCWD))
+    return;
+
+  // The emulator returns the host descriptor unless it remaps it:
+  // Check that the descriptor refers to the opened file.
+  struct stat fdStat, pathStat;
+  if (::fstat(int(fd), &fdStat) == 0 and ::stat(path.c_str(), &pathStat) == 0 and
+      fdStat.st_dev == pathStat.st_dev and fdStat.st_ino == pathStat.st_ino)
+    hostFds_.insert(fd);
+}
+
+
+template <typename URV>
+void
+Hart<URV>::copyFromGuest(uint64_t addr, uint8_t* buf, size_t size)
+{
+  size_t i = 0;
+  for ( ; i < size and ((addr + i) & 3) != 0; ++i)
+    memory_.peek(addr + i, buf[i], false);
+
+  for ( ; i + 4 <= size; i += 4)
     {
-      FpKinds kind = pos? FpKinds::PosNormal : FpKinds::NegNormal;
-      histo.at(unsigned(kind))++;
+      uint32_t word = 0;
+      memory_.peek(addr + i, word, false);
+      memcpy(buf + i, &word, 4);
     }
-  else if (type == FP_SUBNORMAL)
+
+  for ( ; i < size; ++i)
+    memory_.peek(addr + i, buf[i], false);
+}
+
+
+template <typename URV>
+void
+Hart<URV>::copyToGuest(uint64_t addr, const uint8_t* buf, size_t size)
+{
+  std::lock_guard<std::mutex> lock(memory_.lrMutex_);
+
+  memory_.invalidateLrs(addr, size);
+
+  size_t i = 0;
+  for ( ; i < size and ((addr + i) & 3) != 0; ++i)
+    memory_.poke(addr + i, buf[i], false);
+
+  for ( ; i + 4 <= size; i += 4)
     {
-      FpKinds kind = pos? FpKinds::PosSubnormal : FpKinds::NegSubnormal;
-      histo.at(unsigned(kind))++;
+      uint32_t word = 0;
+      memcpy(&word, buf + i, 4);
+      memory_.poke(addr + i, word, false);
     }
-  else if (type == FP_ZERO)
+
+  for ( ; i < size; ++i)
+    memory_.poke(addr + i, buf[i], false);
+
+  invalidateDecodeCache(addr, size);
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::cancelLastDiv()
+{
+  if (not hasLastDiv_)
+    return false;
+
+  hasLastDiv_ = false;
+  return pokeIntReg(lastDivRd_, priorDivRdVal_);
+}
+
+
+
+template <typename URV>
+void
+Hart<URV>::undoForTrigger()
+{
+  unsigned regIx = 0;
+  URV value = 0;
+  if (intRegs_.getLastWrittenReg(regIx, value))
     {
-      FpKinds kind = pos? FpKinds::PosZero : FpKinds::NegZero;
-      histo.at(unsigned(kind))++;
+      pokeIntReg(regIx, value);
+      intRegs_.clearLastWrittenReg();
     }
-  else if (type == FP_NAN)
+
+  uint64_t fpVal = 0;
+  if (fpRegs_.getLastWrittenReg(regIx, fpVal))
     {
-      bool quiet = mostSignificantFractionBit(val);
-      FpKinds kind = quiet? FpKinds::QuietNan : FpKinds::SignalingNan;
-      histo.at(unsigned(kind))++;
+      pokeFpReg(regIx, fpVal);
+      fpRegs_.clearLastWrittenReg();
     }
+
+  setPc(currPc_);
+}
+
+
+/// Map the bit width (1 to 64) of a magnitude to its histogram class:
+/// 0 for widths up to 4 (magnitudes up to 16), 1 up to 10 (1k), 2 up
+/// to 16 (64k) and 3 beyond.
+static constexpr uint8_t histoWidthClass[65] = {
+  0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2,
+  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3 };
+
+
+/// Return the bit width of the given non-zero value.
+static inline unsigned
+bitWidth(uint64_t x)
+{
+  return 64 - __builtin_clzll(x);
+}
+
+
+/// Return the signed histogram bucket (0 to 12) of the given value
+/// (see printSignedHisto). Values in [-2, 2] have their own bucket;
+/// other values are classified by the bit width of their magnitude.
+static inline unsigned
+signedHistoBucket(int64_t val)
+{
+  bool neg = val < 0;
+  uint64_t mag = neg ? -uint64_t(val) : uint64_t(val) - 1;
+  unsigned cls = histoWidthClass[bitWidth(mag | 1)];
+  unsigned bucket = neg ? 3 - cls : 9 + cls;
+  return (val >= -2 and val <= 2) ? unsigned(6 + val) : bucket;
+}
+
+
+/// Return the unsigned histogram bucket (0 to 6) of the given value
+/// (see printUnsignedHisto).
+static inline unsigned
+unsignedHistoBucket(uint64_t val)
+{
+  unsigned bucket = 3 + histoWidthClass[bitWidth((val - 1) | 1)];
+  return val <= 2 ? unsigned(val) : bucket;
+}
+
+
+/// Return the FpKinds value of the floating point number with the
+/// given bits (float if BITS_TYPE is 32-bit and double if 64-bit)
+/// without branching on the number class.
+template <typename BITS_TYPE>
+static inline unsigned
+fpHistoKind(BITS_TYPE bits)
+{
+  constexpr unsigned width = 8*sizeof(BITS_TYPE);
+  constexpr unsigned mantBits = width == 32 ? 23 : 52;
+  constexpr BITS_TYPE expMask = (BITS_TYPE(1) << (width - 1 - mantBits)) - 1;
+  constexpr BITS_TYPE mantMask = (BITS_TYPE(1) << mantBits) - 1;
+
+  // Kind indexed by: exponent all ones, exponent zero, mantissa
+  // zero, most significant mantissa bit. Kinds below QuietNan are
+  // adjusted by the sign bit.
+  static constexpr uint8_t kinds[16] = {
+    unsigned(FpKinds::PosNormal), unsigned(FpKinds::PosNormal),
+    unsigned(FpKinds::PosNormal), unsigned(FpKinds::PosNormal),
+    unsigned(FpKinds::PosSubnormal), unsigned(FpKinds::PosSubnormal),
+    unsigned(FpKinds::PosZero), unsigned(FpKinds::PosZero),
+    unsigned(FpKinds::SignalingNan), unsigned(FpKinds::QuietNan),
+    unsigned(FpKinds::PosInf), unsigned(FpKinds::PosInf),
+    unsigned(FpKinds::PosNormal), unsigned(FpKinds::PosNormal),
+    unsigned(FpKinds::PosNormal), unsigned(FpKinds::PosNormal) };
+
+  BITS_TYPE exp = (bits >> mantBits) & expMask;
+  BITS_TYPE mant = bits & mantMask;
+  unsigned sign = bits >> (width - 1);
+  unsigned key = ((exp == expMask) << 3) | ((exp == 0) << 2) | ((mant == 0) << 1) |
+    unsigned((mant >> (mantBits - 1)) & 1);
+  unsigned kind = kinds[key];
+  return kind + (sign & (kind < unsigned(FpKinds::QuietNan)));
 }
 
 
@@ -3958,6 +4759,190 @@ Hart<URV>::updatePerformanceCounters(uint32_t inst, const InstEntry& info,
 }
 
 
+/// Return the event associated with the class of the given
+/// instruction. This is the static part of updatePerformanceCounters
+/// (CSR instructions are not covered).
+static EventNumber
+instClassEvent(const InstEntry& info)
+{
+  InstId id = info.instId();
+
+  if (info.type() == InstType::Int)
+    {
+      if (id == InstId::ebreak or id == InstId::c_ebreak)
+        return EventNumber::Ebreak;
+      if (id == InstId::ecall)
+        return EventNumber::Ecall;
+      if (id == InstId::fence or id == InstId::bbarrier)
+        return EventNumber::Fence;
+      if (id == InstId::fencei)
+        return EventNumber::Fencei;
+      if (id == InstId::mret)
+        return EventNumber::Mret;
+      if (id != InstId::illegal)
+        return EventNumber::Alu;
+      return EventNumber::None;
+    }
+
+  if (info.isMultiply())
+    return EventNumber::Mult;
+  if (info.isDivide())
+    return EventNumber::Div;
+  if (info.isLoad())
+    return EventNumber::Load;
+  if (info.isStore())
+    return EventNumber::Store;
+  if (info.isBitManipulation())
+    return EventNumber::Bitmanip;
+  if (info.isAtomic())
+    {
+      if (id == InstId::lr_w or id == InstId::lr_d)
+        return EventNumber::Lr;
+      if (id == InstId::sc_w or id == InstId::sc_d)
+        return EventNumber::Sc;
+      return EventNumber::Atomic;
+    }
+  if (info.isBranch())
+    return EventNumber::Branch;
+
+  return EventNumber::None;
+}
+
+
+template <typename URV>
+void
+Hart<URV>::definePerfInstEvents()
+{
+  if (not perfInstEvent_.empty())
+    return;
+
+  perfInstEvent_.resize(size_t(InstId::maxId) + 1);
+  for (size_t i = 0; i < perfInstEvent_.size(); ++i)
+    perfInstEvent_.at(i) = uint8_t(instClassEvent(instTable_.getEntry(InstId(i))));
+}
+
+
+template <typename URV>
+void
+Hart<URV>::definePerfLdStEvents()
+{
+  perfLdStEvents_ = false;
+  for (unsigned ix = 3; ix <= 31; ++ix)
+    {
+      URV event = 0;
+      auto eventCsr = CsrNumber(unsigned(CsrNumber::MHPMEVENT3) + ix - 3);
+      if (not peekCsr(eventCsr, event))
+        continue;
+      if (event == URV(EventNumber::MisalignLoad) or
+          event == URV(EventNumber::MisalignStore) or
+          event == URV(EventNumber::BusLoad) or
+          event == URV(EventNumber::BusStore))
+        perfLdStEvents_ = true;
+    }
+}
+
+
+template <typename URV>
+inline
+void
+Hart<URV>::deferPerformanceCounters(const DecodedInst& di)
+{
+  if (hasInterrupt_ or (debugMode_ and isDebugModeStopCount(*this)))
+    return;
+
+  const InstEntry& info = *(di.instEntry());
+  InstId id = info.instId();
+
+  // CSR instructions are counted by updatePerformanceCountersForCsr.
+  if (info.isCsr())
+    {
+      prevPerfControl_ = perfControl_;
+      return;
+    }
+
+  // See updatePerformanceCounters.
+  if (hasException_ and id != InstId::ecall and id != InstId::ebreak and
+      id != InstId::c_ebreak)
+    return;
+
+  // Slot of EventNumber::None collects instructions without an event.
+  auto& counts = perfEventCount_;
+  counts[perfInstEvent_[size_t(id)]]++;
+  counts[size_t(EventNumber::InstCommited)]++;
+  if (isCompressedInst(di.inst()))
+    counts[size_t(EventNumber::Inst16Commited)]++;
+  else
+    counts[size_t(EventNumber::Inst32Commited)]++;
+  perfPending_ = true;
+
+  if (info.isBranch())
+    {
+      counts[size_t(EventNumber::BranchTaken)] += lastBranchTaken_;
+      lastBranchTaken_ = false;
+    }
+  else if (not perfLdStEvents_)
+    return;
+  else if (info.isLoad())
+    {
+      counts[size_t(EventNumber::MisalignLoad)] += misalignedLdSt_;
+      counts[size_t(EventNumber::BusLoad)] += isDataAddressExternal(ldStAddr_);
+    }
+  else if (info.isStore())
+    {
+      counts[size_t(EventNumber::MisalignStore)] += misalignedLdSt_;
+      size_t addr = 0;
+      uint64_t value = 0;
+      memory_.getLastWriteOldValue(hartIx_, addr, value);
+      counts[size_t(EventNumber::BusStore)] += isDataAddressExternal(addr);
+    }
+}
+
+
+template <typename URV>
+void
+Hart<URV>::materializePerfCounters()
+{
+  if (not perfPending_)
+    return;
+  perfPending_ = false;
+
+  // Add the pending counts to the counters associated with the events.
+  for (unsigned ix = 3; ix <= 31; ++ix)
+    {
+      if (((prevPerfControl_ >> ix) & 1) == 0)
+        continue;  // Counter inhibited.
+
+      URV event = 0;
+      auto eventCsr = CsrNumber(unsigned(CsrNumber::MHPMEVENT3) + ix - 3);
+      if (not peekCsr(eventCsr, event) or event == 0 or event >= perfEventCount_.size())
+        continue;
+
+      uint64_t count = perfEventCount_.at(event);
+      if (count == 0)
+        continue;
+
+      auto lowCsr = CsrNumber(unsigned(CsrNumber::MHPMCOUNTER3) + ix - 3);
+      URV low = 0;
+      if (not peekCsr(lowCsr, low))
+        continue;
+
+      if constexpr (sizeof(URV) == 4)
+        {
+          auto highCsr = CsrNumber(unsigned(CsrNumber::MHPMCOUNTER3H) + ix - 3);
+          URV high = 0;
+          peekCsr(highCsr, high);
+          uint64_t value = ((uint64_t(high) << 32) | low) + count;
+          csRegs_.poke(lowCsr, URV(value));
+          csRegs_.poke(highCsr, URV(value >> 32));
+        }
+      else
+        csRegs_.poke(lowCsr, URV(low + count));
+    }
+
+  perfEventCount_.fill(0);
+}
+
+
 template <typename URV>
 void
 Hart<URV>::updatePerformanceCountersForCsr(const DecodedInst& di)
@@ -3967,6 +4952,9 @@ Hart<URV>::updatePerformanceCountersForCsr(const DecodedInst& di)
   if (not enableCounters_)
     return;
 
+  if (perfPending_)
+    materializePerfCounters();
+
   if (not info.isCsr())
     return;
 
@@ -3987,7 +4975,12 @@ Hart<URV>::accumulateInstructionStats(const DecodedInst& di)
       // letting CSR instruction write. Consequently we update the counters
       // from within the code executing the CSR instruction.
       if (not info.isCsr())
-        updatePerformanceCounters(di.inst(), info, di.op0(), di.op1());
+        {
+          if (lazyPerfCounters_)
+            deferPerformanceCounters(di);
+          else
+            updatePerformanceCounters(di.inst(), info, di.op0(), di.op1());
+        }
     }
 
   prevPerfControl_ = perfControl_;
@@ -4002,18 +4995,27 @@ Hart<URV>::accumulateInstructionStats(const DecodedInst& di)
   misalignedLdSt_ = false;
   lastBranchTaken_ = false;
 
+  if (enableEnergy_)
+    {
+      auto region = EnergyModel::MemRegion::None;
+      if (ldStAddrValid_ and (info.isLoad() or info.isStore() or info.isAtomic()))
+        region = (isAddrInDccm(ldStAddr_) ? EnergyModel::MemRegion::Dccm :
+                  EnergyModel::MemRegion::External);
+      energyModel_.account(di.address(), id, region);
+    }
+
   if (not instFreq_)
     return;
 
-  InstProfile& prof = instProfileVec_.at(size_t(id));
+  InstProfileArena& prof = instProfiles_;
 
-  prof.freq_++;
+  prof.freq(id)++;
   if (lastPriv_ == PrivilegeMode::User)
-    prof.user_++;
+    prof.user(id)++;
   else if (lastPriv_ == PrivilegeMode::Supervisor)
-    prof.supervisor_++;
+    prof.supervisor(id)++;
   else if (lastPriv_ == PrivilegeMode::Machine)
-    prof.machine_++;
+    prof.machine(id)++;
 
   unsigned opIx = 0;  // Operand index
 
@@ -4028,7 +5030,7 @@ Hart<URV>::accumulateInstructionStats(const DecodedInst& di)
       rdType = info.ithOperandType(0);
       if (rdType == OperandType::IntReg or rdType == OperandType::FpReg)
         {
-          prof.destRegFreq_.at(di.op0())++;
+          prof.destRegFreq(id)[di.op0()]++;
           opIx++;
           if (rdType == OperandType::IntReg)
             {
@@ -4046,66 +5048,49 @@ Hart<URV>::accumulateInstructionStats(const DecodedInst& di)
   unsigned maxOperand = 4;  // At most 4 operands (including immediate).
   unsigned srcIx = 0;  // Processed source operand rank.
 
-  for (unsigned i = opIx; i < maxOperand; ++i)
+  for (unsigned i = opIx; i < maxOperand and srcIx < prof.maxSources; ++i)
     {
-      if (info.ithOperandType(i) == OperandType::IntReg)
+      OperandType type = info.ithOperandType(i);
+      if (type == OperandType::IntReg)
         {
 	  uint32_t regIx = di.ithOperand(i);
-	  prof.srcRegFreq_.at(srcIx).at(regIx)++;
+	  prof.srcRegFreq(id, srcIx)[regIx]++;
 
           URV val = intRegs_.read(regIx);
           if (regIx == rd and rdType == OperandType::IntReg)
             val = rdOrigVal;
+          uint64_t* histo = prof.srcHisto(id, srcIx);
           if (info.isUnsigned())
-            addToUnsignedHistogram(prof.srcHisto_.at(srcIx), val);
+            histo[unsignedHistoBucket(val)]++;
           else
-            addToSignedHistogram(prof.srcHisto_.at(srcIx), SRV(val));
+            histo[signedHistoBucket(SRV(val))]++;
 
           srcIx++;
 	}
-      else if (info.ithOperandType(i) == OperandType::FpReg)
+      else if (type == OperandType::FpReg)
         {
 	  uint32_t regIx = di.ithOperand(i);
-	  prof.srcRegFreq_.at(srcIx).at(regIx)++;
+	  prof.srcRegFreq(id, srcIx)[regIx]++;
 
           uint64_t val = fpRegs_.readBitsRaw(regIx);
           if (regIx == rd and rdType == OperandType::FpReg)
             val = frdOrigVal;
           bool sp = fpRegs_.isNanBoxed(val) or not isRvd();
+          uint64_t* histo = prof.srcHisto(id, srcIx);
           if (sp)
-            {
-              FpRegs::FpUnion u{val};
-              float spVal = u.sp.sp;
-              addToFpHistogram(prof.srcHisto_.at(srcIx), spVal);
-            }
+            histo[fpHistoKind(uint32_t(val))]++;
           else
-            {
-              FpRegs::FpUnion u{val};
-              double dpVal = u.dp;
-              addToFpHistogram(prof.srcHisto_.at(srcIx), dpVal);
-            }
+            histo[fpHistoKind(val)]++;
 
           srcIx++;
         }
-      else if (info.ithOperandType(i) == OperandType::Imm)
+      else if (type == OperandType::Imm)
         {
           int32_t imm = di.ithOperand(i);
-          prof.hasImm_ = true;
-          if (prof.freq_ == 1)
-            {
-              prof.minImm_ = prof.maxImm_ = imm;
-            }
-          else
-            {
-              prof.minImm_ = std::min(prof.minImm_, imm);
-              prof.maxImm_ = std::max(prof.maxImm_, imm);
-            }
-          addToSignedHistogram(prof.srcHisto_.back(), imm);
+          prof.addImm(id, imm);
+          prof.immHisto(id)[signedHistoBucket(imm)]++;
         }
     }
-
-  if (prof.hasImm_)
-    assert(srcIx + 1 < maxOperand);
 }
 
 
@@ -4425,6 +5410,8 @@ Hart<URV>::logStop(const CoreException& ce, uint64_t counter, FILE* traceFile)
   bool success = false;
   bool isRetired = false;
 
+  flushOutputBuffer();
+
   if (ce.type() == CoreException::Stop)
     {
       isRetired = true;
@@ -4550,7 +5537,7 @@ Hart<URV>::untilAddress(size_t address, FILE* traceFile)
   clearTraceData();
 
   uint64_t limit = instCountLim_;
-  bool doStats = instFreq_ or enableCounters_;
+  bool doStats = instFreq_ or enableCounters_ or enableEnergy_;
 
   // Check for gdb break every 1000000 instructions.
   unsigned gdbCount = 0, gdbLimit = 1000000;
@@ -4558,11 +5545,25 @@ Hart<URV>::untilAddress(size_t address, FILE* traceFile)
   if (enableGdb_)
     handleExceptionForGdb(*this, gdbInputFd_);
 
-  while (pc_ != address and instCounter_ < limit)
+  // The stop address and the breakpoints are flagged pcs: They are
+  // never in the decode cache and are checked on a miss only.
+  setRunStopAddress(address);
+
+  // Without gdb, resuming at a breakpoint steps over it: Otherwise the
+  // run would stop again without progress.
+  bool stepOver = not enableGdb_ and hasBreakpoint(pc_) and pc_ != address;
+
+  while (instCounter_ < limit)
     {
       if (userStop)
         break;
 
+      if (statsSnapInterval_ and instCounter_ >= nextStatsSnap_)
+        takeStatsSnapshot();
+
+      if (instCounter_ >= nextCheckpoint_)
+        takeCheckpoint();
+
       if (enableGdb_ and ++gdbCount >= gdbLimit)
         {
           gdbCount = 0;
@@ -4582,6 +5583,7 @@ Hart<URV>::untilAddress(size_t address, FILE* traceFile)
               if (reset)
                 {
                   this->reset();
+                  setRunStopAddress(~URV(0));
                   return true;
                 }
               if (not halt)
@@ -4589,6 +5591,20 @@ Hart<URV>::untilAddress(size_t address, FILE* traceFile)
             }
         }
 
+      uint32_t ix = (pc_ >> 1) & decodeCacheMask_;
+      DecodedInst* di = &decodeCache_[ix];
+      bool hit = di->isValid() and di->address() == pc_;
+      if (not hit and isFlaggedPc(pc_) and not stepOver)
+        {
+          if (pc_ == address or not enableGdb_)
+            break;
+          handleExceptionForGdb(*this, gdbInputFd_);
+          ix = (pc_ >> 1) & decodeCacheMask_;
+          di = &decodeCache_[ix];
+          hit = di->isValid() and di->address() == pc_;
+        }
+      stepOver = false;
+
       try
 	{
           uint32_t inst = 0;
@@ -4601,107 +5617,831 @@ Hart<URV>::untilAddress(size_t address, FILE* traceFile)
 
 	  ++instCounter_;
 
-          if (processExternalInterrupt(traceFile, instStr))
-            continue;
+          if (processExternalInterrupt(traceFile, instStr))
+            continue;
+
+          if (not fetchInstWithTrigger(pc_, inst, traceFile))
+            {
+	      clearTraceData();
+              continue;  // Next instruction in trap handler.
+            }
+
+	  // Decode unless match in decode cache. Keep flagged pcs out of
+	  // the cache.
+	  if (not hit)
+            {
+              decode(pc_, inst, *di);
+              if (isFlaggedPc(pc_))
+                di->invalidate();
+            }
+
+          // Increment pc and execute instruction
+	  pc_ += di->instSize();
+	  execute(di);
+
+	  ++cycleCount_;
+
+	  if (hasException_ or hasInterrupt_)
+	    {
+              if (doStats)
+                accumulateInstructionStats(*di);
+	      if (traceFile)
+		{
+		  printDecodedInstTrace(*di, instCounter_, instStr, traceFile);
+		  clearTraceData();
+		}
+	      continue;
+	    }
+
+	  if (triggerTripped_)
+	    {
+	      undoForTrigger();
+	      if (takeTriggerAction(traceFile, currPc_, currPc_, instCounter_, true))
+		break;
+	      continue;
+	    }
+
+          hwLoopBackEdge(currPc_, di->instSize());
+
+          if (minstretEnabled())
+            ++retiredInsts_;
+
+	  if (doStats)
+	    accumulateInstructionStats(*di);
+
+	  if (trace)
+	    {
+	      if (traceFile)
+		printDecodedInstTrace(*di, instCounter_, instStr, traceFile);
+	      clearTraceData();
+	    }
+
+	  bool icountHit = (enableTriggers_ and
+			    icountTriggerHit(privMode_, isInterruptEnabled()));
+	  if (icountHit)
+	    if (takeTriggerAction(traceFile, pc_, pc_, instCounter_, false))
+	      break;
+          prevPerfControl_ = perfControl_;
+	}
+      catch (const CoreException& ce)
+	{
+	  setRunStopAddress(~URV(0));
+	  return logStop(ce, instCounter_, traceFile);
+	}
+    }
+
+  setRunStopAddress(~URV(0));
+  return true;
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::runUntilAddress(size_t address, FILE* traceFile)
+{
+  struct timeval t0;
+  gettimeofday(&t0, nullptr);
+
+  uint64_t limit = instCountLim_;
+  uint64_t counter0 = instCounter_;
+
+  // Setup signal handlers. Restore on destruction.
+  SignalHandlers handlers;
+
+  // Defer performance counter updates unless something may peek at
+  // the counters between instructions.
+  lazyPerfCounters_ = enableCounters_ and not perModeCounters_ and
+    not enableGdb_ and not preInst_;
+  if (lazyPerfCounters_)
+    definePerfLdStEvents();
+
+  bool success = untilAddress(address, traceFile);
+  flushOutputBuffer();
+
+  lazyPerfCounters_ = false;
+  materializePerfCounters();
+      
+  if (instCounter_ == limit)
+    std::cerr << "Stopped -- Reached instruction limit\n";
+  else if (pc_ == address)
+    std::cerr << "Stopped -- Reached end address\n";
+  else if (hasBreakpoint(pc_) and not enableGdb_ and not userStop)
+    std::cerr << "Stopped -- Reached breakpoint\n";
+
+  // Simulator stats.
+  struct timeval t1;
+  gettimeofday(&t1, nullptr);
+  double elapsed = (double(t1.tv_sec - t0.tv_sec) +
+		    double(t1.tv_usec - t0.tv_usec)*1e-6);
+
+  uint64_t numInsts = instCounter_ - counter0;
+  lastRunInsts_ = numInsts;
+  lastRunSeconds_ = elapsed;
+
+  reportInstsPerSec(numInsts, elapsed, userStop);
+  return success;
+}
+
+
+/// Return true if given CSR is a counter (cycle, time, instret or
+/// performance counter). Those are not maintained by the fast run
+/// loop and are skipped by the lockstep comparison.
+static bool
+isCounterCsr(CsrNumber csr)
+{
+  unsigned num = unsigned(csr);
+  return (num >= 0xb00 and num <= 0xb9f) or (num >= 0xc00 and num <= 0xc9f);
+}
+
+
+template <typename URV>
+unsigned
+Hart<URV>::compareArchState(const Hart<URV>& other, FILE* out) const
+{
+  unsigned errors = 0;
+
+  if (pc_ != other.pc_)
+    {
+      if (out)
+        fprintf(out, "  pc: 0x%" PRIx64 " vs 0x%" PRIx64 "\n", uint64_t(pc_),
+                uint64_t(other.pc_));
+      errors++;
+    }
+
+  if (privMode_ != other.privMode_)
+    {
+      if (out)
+        fprintf(out, "  privilege: %u vs %u\n", unsigned(privMode_),
+                unsigned(other.privMode_));
+      errors++;
+    }
+
+  for (unsigned i = 1; i < intRegs_.size(); ++i)
+    {
+      URV v0 = intRegs_.read(i), v1 = other.intRegs_.read(i);
+      if (v0 == v1)
+        continue;
+      if (out)
+        fprintf(out, "  x%u: 0x%" PRIx64 " vs 0x%" PRIx64 "\n", i,
+                uint64_t(v0), uint64_t(v1));
+      errors++;
+    }
+
+  for (unsigned i = 0; i < fpRegCount(); ++i)
+    {
+      uint64_t v0 = fpRegs_.readBitsRaw(i), v1 = other.fpRegs_.readBitsRaw(i);
+      if (v0 == v1)
+        continue;
+      if (out)
+        fprintf(out, "  f%u: 0x%" PRIx64 " vs 0x%" PRIx64 "\n", i, v0, v1);
+      errors++;
+    }
+
+  std::vector<CsrNumber> csrs;
+  getImplementedCsrs(csrs);
+  for (auto csr : csrs)
+    {
+      if (isCounterCsr(csr))
+        continue;
+      URV v0 = 0, v1 = 0;
+      std::string name;
+      if (not peekCsr(csr, v0, name) or not other.peekCsr(csr, v1))
+        continue;
+      if (v0 == v1)
+        continue;
+      if (out)
+        fprintf(out, "  %s: 0x%" PRIx64 " vs 0x%" PRIx64 "\n", name.c_str(),
+                uint64_t(v0), uint64_t(v1));
+      errors++;
+    }
+
+  return errors;
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::runLockstep(Hart<URV>& ref, uint64_t interval, unsigned window,
+                       FILE* out)
+{
+  if (interval == 0)
+    interval = 1;
+
+  // Circular buffer of the last instructions executed by the reference hart.
+  struct TrailEntry
+  {
+    uint64_t tag = 0;
+    URV pc = 0;
+    uint32_t inst = 0;
+  };
+  std::vector<TrailEntry> trail(std::max(window, 1u));
+  uint64_t trailIx = 0;
+
+  uint64_t limit = instCountLim_;
+  bool fastDone = false, success = true;
+
+  // Setup signal handlers. Restore on destruction.
+  SignalHandlers handlers;
+
+  while (noUserStop and not fastDone and instCounter_ < limit)
+    {
+      uint64_t counter0 = instCounter_;
+
+      // Advance this hart interval instructions using the fast loop.
+      instCountLim_ = std::min(limit, instCounter_ + interval);
+      try
+        {
+          fastLoopBail_ = false;
+          simpleRunWithLimit();
+        }
+      catch (const CoreException& ce)
+        {
+          fastDone = true;
+          success = logStop(ce, instCounter_, nullptr);
+        }
+      instCountLim_ = limit;
+
+      // Fast loop bailed out: Stopped at a breakpoint if no progress
+      // was made, otherwise the next interval resumes it.
+      if (fastLoopBail_)
+        {
+          fastLoopBail_ = false;
+          if (instCounter_ == counter0)
+            fastDone = true;
+        }
+
+      // Advance the reference hart to the same instruction count.
+      while (ref.instCounter_ < instCounter_ and not ref.hasTargetProgramFinished())
+        {
+          TrailEntry& entry = trail.at(trailIx++ % trail.size());
+          entry.tag = ref.instCounter_ + 1;
+          entry.pc = ref.pc_;
+          entry.inst = 0;
+          ref.readInst(ref.pc_, entry.inst);
+          ref.singleStep(nullptr);
+        }
+
+      bool refDone = ref.hasTargetProgramFinished();
+      bool sameCount = ref.instCounter_ == instCounter_;
+      if (fastDone == refDone and sameCount and compareArchState(ref, nullptr) == 0)
+        continue;
+
+      fprintf(out, "Lockstep mismatch between instructions %" PRIu64 " and %"
+              PRIu64 " (fast vs reference):\n", counter0, instCounter_);
+      if (not sameCount or fastDone != refDone)
+        fprintf(out, "  instructions: %" PRIu64 "%s vs %" PRIu64 "%s\n",
+                instCounter_, fastDone? " (stopped)" : "", ref.instCounter_,
+                refDone? " (stopped)" : "");
+      compareArchState(ref, out);
+
+      uint64_t count = std::min(trailIx, uint64_t(trail.size()));
+      fprintf(out, "Last %" PRIu64 " instructions executed by reference hart:\n",
+              count);
+      for (uint64_t i = trailIx - count; i < trailIx; ++i)
+        {
+          const TrailEntry& entry = trail.at(i % trail.size());
+          std::string text;
+          disassembleInst(entry.inst, text);
+          fprintf(out, "  #%" PRIu64 " 0x%" PRIx64 " %08x %s\n", entry.tag,
+                  uint64_t(entry.pc), entry.inst, text.c_str());
+        }
+      return false;
+    }
+
+  if (userStop)
+    std::cerr << "Stopped -- interrupted\n";
+
+  return success;
+}
+
+
+template <typename URV>
+void
+Hart<URV>::enableReverseExecution(uint64_t interval, unsigned maxCount)
+{
+  revInterval_ = interval;
+  maxCheckpoints_ = std::max(maxCount, 1u);
+  nextCheckpoint_ = interval? instCounter_ : ~uint64_t(0);
+  checkpoints_.clear();
+  reExecHighWater_ = 0;
+  if (replayingInputs_)
+    return;  // Logs come from the replay file.
+
+  logInputs_ = interval != 0;
+  revHighWater_ = 0;
+  conInLog_.clear();
+  conInIx_ = 0;
+  intrLog_.clear();
+  intrIx_ = 0;
+  syscallLog_.clear();
+  syscallIx_ = 0;
+}
+
+
+template <typename URV>
+void
+Hart<URV>::takeCheckpoint()
+{
+  Checkpoint cp;
+  cp.tag_ = instCounter_;
+  cp.retired_ = retiredInsts_;
+  cp.cycles_ = cycleCount_;
+  cp.alarmLimit_ = alarmLimit_;
+  cp.pc_ = pc_;
+  cp.priv_ = privMode_;
+  cp.conInIx_ = conInIx_;
+  cp.intrIx_ = intrIx_;
+  cp.syscallIx_ = syscallIx_;
+
+  for (unsigned i = 0; i < intRegs_.size(); ++i)
+    cp.intRegs_.push_back(intRegs_.read(i));
+
+  for (unsigned i = 0; i < fpRegCount(); ++i)
+    cp.fpRegs_.push_back(fpRegs_.readBitsRaw(i));
+
+  std::vector<CsrNumber> csrs;
+  getImplementedCsrs(csrs);
+  for (auto csr : csrs)
+    {
+      URV val = 0;
+      if (peekCsr(csr, val))
+        cp.csrs_.push_back({csr, val});
+    }
+
+  checkpoints_.push_back(std::move(cp));
+  if (checkpoints_.size() > maxCheckpoints_)
+    checkpoints_.erase(checkpoints_.begin());
+
+  nextCheckpoint_ = instCounter_ + revInterval_;
+}
+
+
+template <typename URV>
+void
+Hart<URV>::restoreCheckpoint(size_t ix)
+{
+  // Undo memory writes, latest checkpoint first: A page written in
+  // several intervals gets the content saved by the earliest one.
+  for (size_t j = checkpoints_.size(); j > ix; --j)
+    for (const auto& [page, data] : checkpoints_.at(j - 1).pages_)
+      for (size_t i = 0; i < data.size(); ++i)
+        memory_.poke((page << 12) + i, data[i], false);
+
+  checkpoints_.erase(checkpoints_.begin() + ix + 1, checkpoints_.end());
+  const Checkpoint& cp = checkpoints_.at(ix);
+
+  for (unsigned i = 1; i < cp.intRegs_.size(); ++i)
+    intRegs_.write(i, cp.intRegs_.at(i));
+
+  for (unsigned i = 0; i < cp.fpRegs_.size(); ++i)
+    fpRegs_.pokeBits(i, cp.fpRegs_.at(i));
+
+  for (const auto& [csr, val] : cp.csrs_)
+    pokeCsr(csr, val);
+
+  instCounter_ = cp.tag_;
+  retiredInsts_ = cp.retired_;
+  cycleCount_ = cp.cycles_;
+  alarmLimit_ = cp.alarmLimit_;
+  pc_ = cp.pc_;
+  privMode_ = cp.priv_;
+  conInIx_ = cp.conInIx_;
+  intrIx_ = cp.intrIx_;
+  syscallIx_ = cp.syscallIx_;
+  nextCheckpoint_ = cp.tag_ + revInterval_;
+
+  // Restored memory may include page tables.
+  loadQueue_.clear();
+  virtMem_.tlb_.invalidate();
+  invalidateDecodeCache();
+}
+
+
+template <typename URV>
+void
+Hart<URV>::saveCheckpointPages(uint64_t addr, unsigned size)
+{
+  if (checkpoints_.empty())
+    return;
+
+  auto& pages = checkpoints_.back().pages_;
+  for (uint64_t page = addr >> 12; page <= (addr + size - 1) >> 12; ++page)
+    {
+      if (pages.count(page))
+        continue;
+      auto& data = pages[page];
+      data.resize(4096);
+      for (unsigned i = 0; i < data.size(); ++i)
+        memory_.peek((page << 12) + i, data[i], false);
+    }
+}
+
+
+template <typename URV>
+uint64_t
+Hart<URV>::replayTo(uint64_t target)
+{
+  uint64_t lastBreak = ~uint64_t(0);
+  uint64_t limit = instCountLim_;
+
+  while (noUserStop and instCounter_ < target)
+    {
+      if (hasBreakpoint(pc_))
+        lastBreak = instCounter_;
+
+      if (instCounter_ >= nextCheckpoint_)
+        takeCheckpoint();
+
+      // Run the fast loop up to the next checkpoint or the instruction
+      // preceding the next logged interrupt.
+      uint64_t stop = std::min(target, nextCheckpoint_);
+      if (intrIx_ < intrLog_.size() and intrLog_.at(intrIx_).tag_ <= stop)
+        stop = intrLog_.at(intrIx_).tag_ - 1;
+
+      uint64_t count0 = instCounter_;
+      if (stop > instCounter_)
+        {
+          instCountLim_ = stop;
+          fastLoopBail_ = false;
+          simpleRunWithLimit();
+          fastLoopBail_ = false;
+        }
+
+      // Logged interrupt or flagged pc: Use the full single step.
+      if (instCounter_ == count0)
+        singleStep(nullptr);
+    }
+
+  instCountLim_ = limit;
+  return lastBreak;
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::reverseStep()
+{
+  if (checkpoints_.empty() or instCounter_ <= checkpoints_.front().tag_)
+    return false;
+
+  uint64_t target = instCounter_ - 1;
+  revHighWater_ = std::max(revHighWater_, instCounter_);
+  reExecHighWater_ = std::max(reExecHighWater_, instCounter_);
+
+  size_t ix = checkpoints_.size() - 1;
+  while (checkpoints_.at(ix).tag_ > target)
+    --ix;
+
+  restoreCheckpoint(ix);
+  replayTo(target);
+  return true;
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::reverseContinue()
+{
+  if (checkpoints_.empty() or instCounter_ <= checkpoints_.front().tag_)
+    return false;
+
+  uint64_t end = instCounter_;
+  revHighWater_ = std::max(revHighWater_, instCounter_);
+  reExecHighWater_ = std::max(reExecHighWater_, instCounter_);
+
+  // Scan the intervals latest first for a breakpoint hit, then replay
+  // up to the latest hit of the first interval having one.
+  for (size_t ix = checkpoints_.size(); ix > 0; --ix)
+    {
+      uint64_t start = checkpoints_.at(ix - 1).tag_;
+      if (start >= end)
+        continue;
+
+      restoreCheckpoint(ix - 1);
+      uint64_t hit = replayTo(end);
+      if (hit != ~uint64_t(0))
+        {
+          restoreCheckpoint(ix - 1);
+          replayTo(hit);
+          return true;
+        }
+      end = start;
+    }
+
+  restoreCheckpoint(0);
+  return false;
+}
+
+
+/// Magic number at the start of an input record file (see
+/// Hart::recordInputs). Followed by a version byte and the size in
+/// bytes of an integer register. Version 1 files have the input
+/// system calls only: They can still be replayed.
+static const char inputLogMagic[] = "WIRL";
+static const uint8_t inputLogVersion = 2;
+
+
+/// Write given value to the given file as an unsigned LEB128 varint.
+static void
+writeVarint(FILE* file, uint64_t val)
+{
+  do
+    {
+      uint8_t byte = val & 0x7f;
+      val >>= 7;
+      if (val)
+        byte |= 0x80;
+      fputc(byte, file);
+    }
+  while (val);
+}
+
+
+/// Read an unsigned LEB128 varint from the given file. Return false
+/// on end of file or on a malformed value.
+static bool
+readVarint(FILE* file, uint64_t& val)
+{
+  val = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+      int c = fgetc(file);
+      if (c == EOF)
+        return false;
+      val |= uint64_t(c & 0x7f) << shift;
+      if ((c & 0x80) == 0)
+        return true;
+    }
+  return false;
+}
+
+
+template <typename URV>
+int
+Hart<URV>::readConsoleInput()
+{
+  if (not logInputs_ and not recordFile_)
+    return fgetc(stdin);
+
+  if (conInIx_ < conInLog_.size())
+    return conInLog_.at(conInIx_++);
+
+  int c = fgetc(stdin);
+  if (recordFile_)
+    {
+      writeInputRecord(InputKind::ConsoleIn);
+      writeVarint(recordFile_, uint64_t(c + 1));  // EOF (-1) is 0.
+    }
+  if (logInputs_)
+    {
+      conInLog_.push_back(c);
+      conInIx_ = conInLog_.size();
+    }
+  return c;
+}
+
+
+template <typename URV>
+void
+Hart<URV>::logInterrupt(URV cause, bool nmi)
+{
+  URV mip = csRegs_.peekMip();
+  if (recordFile_)
+    {
+      writeInputRecord(nmi? InputKind::Nmi : InputKind::Interrupt);
+      writeVarint(recordFile_, cause);
+      writeVarint(recordFile_, mip);
+    }
+  if (logInputs_)
+    {
+      intrLog_.push_back({instCounter_, cause, mip, nmi});
+      intrIx_ = intrLog_.size();
+    }
+}
+
+
+/// Return true if the given system call writes guest memory with
+/// content coming from the host (input data, time, file status). Set
+/// addr and size to the largest memory area it may write. The status
+/// structures are recorded with a size covering the RV32 and RV64
+/// layouts: Bytes past the structure are rewritten with their own
+/// (recorded) value.
+template <typename URV>
+static bool
+syscallWrittenArea(URV num, URV a0, URV a1, URV a2, URV a3, uint64_t& addr,
+                   uint64_t& size)
+{
+  const uint64_t statSize = 128;
+
+  switch (num)
+    {
+    case 63:   // read
+    case 67:   // pread64
+      addr = a1; size = a2;
+      return true;
+    case 17:   // getcwd
+      addr = a0; size = a1;
+      return true;
+    case 78:   // readlinkat
+      addr = a2; size = a3;
+      return true;
+    case 79:   // fstatat
+      addr = a2; size = statSize;
+      return true;
+    case 80:   // fstat
+    case 1038: // stat (newlib)
+    case 1039: // lstat (newlib)
+      addr = a1; size = statSize;
+      return true;
+    case 160:  // uname
+      addr = a0; size = 6 * 65;
+      return true;
+    case 113:  // clock_gettime
+      addr = a1; size = 16;
+      return true;
+    case 153:  // times
+      addr = a0; size = 4 * sizeof(URV);
+      return true;
+    case 169:  // gettimeofday
+      addr = a0; size = 16;
+      return true;
+    }
+  return false;
+}
+
+
+template <typename URV>
+URV
+Hart<URV>::emulateSyscall()
+{
+  URV ret = 0;
+  if (not logInputs_ and not recordFile_)
+    return hostSyscall();
+
+  // Every call is logged: Besides the input calls, the results of
+  // the others (file descriptors, offsets, errors) depend on the host
+  // and would differ if the call was emulated again.
+  URV num = intRegs_.read(RegA7), a0 = intRegs_.read(RegA0);
+  uint64_t addr = 0, size = 0;
+  syscallWrittenArea(num, a0, intRegs_.read(RegA1), intRegs_.read(RegA2),
+                     intRegs_.read(RegA3), addr, size);
+
+  if (revInterval_ and size)
+    saveCheckpointPages(addr, size);
+
+  // Replaying: Reproduce the recorded result without emulating. When
+  // replaying a record file (not re-executing), the output to stdout
+  // and stderr is done again so that it appears in this run.
+  if (instCounter_ <= revHighWater_ and syscallIx_ < syscallLog_.size() and
+      syscallLog_.at(syscallIx_).tag_ == instCounter_)
+    {
+      bool output = (num == 64 or num == 66) and (a0 == 1 or a0 == 2);
+      if (output and not isReExecuting())
+        hostSyscall();
+
+      const SyscallLogEntry& entry = syscallLog_.at(syscallIx_++);
+      for (size_t i = 0; i < entry.data_.size(); ++i)
+        pokeMemory(entry.addr_ + i, entry.data_.at(i), false);
+      return entry.ret_;
+    }
+
+  ret = hostSyscall();
+
+  // Memory written: All of it for the time and status calls, the
+  // bytes read for read/pread64/readlinkat.
+  if (num == 63 or num == 67 or num == 78)
+    size = SRV(ret) > 0 ? std::min(uint64_t(ret), size) : 0;
+  SyscallLogEntry entry{instCounter_, ret, addr, std::vector<uint8_t>(size)};
+  for (size_t i = 0; i < size; ++i)
+    peekMemory(addr + i, entry.data_.at(i), false);
 
-          if (not fetchInstWithTrigger(pc_, inst, traceFile))
-            {
-	      clearTraceData();
-              continue;  // Next instruction in trap handler.
-            }
+  if (recordFile_)
+    {
+      writeInputRecord(InputKind::Syscall);
+      writeVarint(recordFile_, ret);
+      writeVarint(recordFile_, addr);
+      writeVarint(recordFile_, size);
+      if (size)
+        fwrite(entry.data_.data(), 1, size, recordFile_);
+    }
+  if (logInputs_)
+    {
+      // Insert at the current position: A call missing from a version
+      // 1 record file is logged among the replayed ones.
+      syscallLog_.insert(syscallLog_.begin() + syscallIx_, std::move(entry));
+      ++syscallIx_;
+    }
+  return ret;
+}
 
-	  // Decode unless match in decode cache.
-	  uint32_t ix = (pc_ >> 1) & decodeCacheMask_;
-	  DecodedInst* di = &decodeCache_[ix];
-	  if (not di->isValid() or di->address() != pc_)
-	    decode(pc_, inst, *di);
 
-          // Increment pc and execute instruction
-	  pc_ += di->instSize();
-	  execute(di);
+template <typename URV>
+void
+Hart<URV>::writeInputLogHeader()
+{
+  fwrite(inputLogMagic, 1, 4, recordFile_);
+  fputc(inputLogVersion, recordFile_);
+  fputc(sizeof(URV), recordFile_);
+}
 
-	  ++cycleCount_;
 
-	  if (hasException_ or hasInterrupt_)
-	    {
-              if (doStats)
-                accumulateInstructionStats(*di);
-	      if (traceFile)
-		{
-		  printDecodedInstTrace(*di, instCounter_, instStr, traceFile);
-		  clearTraceData();
-		}
-	      continue;
-	    }
+template <typename URV>
+void
+Hart<URV>::writeInputRecord(unsigned kind)
+{
+  // Tags are increasing: Write the difference with the previous one.
+  writeVarint(recordFile_, instCounter_ - recordTag_);
+  fputc(kind, recordFile_);
+  recordTag_ = instCounter_;
+}
 
-	  if (triggerTripped_)
-	    {
-	      undoForTrigger();
-	      if (takeTriggerAction(traceFile, currPc_, currPc_, instCounter_, true))
-		return true;
-	      continue;
-	    }
 
-          if (minstretEnabled())
-            ++retiredInsts_;
+template <typename URV>
+bool
+Hart<URV>::replayInputs(FILE* file)
+{
+  char magic[4] = {};
+  int version = 0;
+  if (fread(magic, 1, 4, file) != 4 or memcmp(magic, inputLogMagic, 4) != 0 or
+      (version = fgetc(file)) < 1 or version > inputLogVersion or
+      fgetc(file) != int(sizeof(URV)))
+    {
+      std::cerr << "Invalid input record file\n";
+      return false;
+    }
 
-	  if (doStats)
-	    accumulateInstructionStats(*di);
+  std::vector<int> conIn;
+  std::vector<InterruptLogEntry> intrs;
+  std::vector<SyscallLogEntry> syscalls;
 
-	  if (trace)
-	    {
-	      if (traceFile)
-		printDecodedInstTrace(*di, instCounter_, instStr, traceFile);
-	      clearTraceData();
-	    }
+  uint64_t tag = 0, delta = 0;
+  while (readVarint(file, delta))
+    {
+      tag += delta;
+      int kind = fgetc(file);
+      uint64_t v0 = 0, v1 = 0, v2 = 0;
+      bool ok = true;
+      if (kind == InputKind::ConsoleIn)
+        {
+          ok = readVarint(file, v0);
+          conIn.push_back(int(v0) - 1);
+        }
+      else if (kind == InputKind::Interrupt or kind == InputKind::Nmi)
+        {
+          ok = readVarint(file, v0) and readVarint(file, v1);
+          intrs.push_back({tag, URV(v0), URV(v1), kind == InputKind::Nmi});
+        }
+      else if (kind == InputKind::Syscall)
+        {
+          ok = readVarint(file, v0) and readVarint(file, v1) and readVarint(file, v2);
+          std::vector<uint8_t> data(ok? v2 : 0);
+          ok = ok and fread(data.data(), 1, data.size(), file) == data.size();
+          syscalls.push_back({tag, URV(v0), v1, std::move(data)});
+        }
+      else
+        ok = false;
 
-	  bool icountHit = (enableTriggers_ and
-			    icountTriggerHit(privMode_, isInterruptEnabled()));
-	  if (icountHit)
-	    if (takeTriggerAction(traceFile, pc_, pc_, instCounter_, false))
-	      return true;
-          prevPerfControl_ = perfControl_;
-	}
-      catch (const CoreException& ce)
-	{
-	  return logStop(ce, instCounter_, traceFile);
-	}
+      if (not ok)
+        {
+          std::cerr << "Truncated or corrupt input record file\n";
+          return false;
+        }
     }
 
+  conInLog_ = std::move(conIn);
+  intrLog_ = std::move(intrs);
+  syscallLog_ = std::move(syscalls);
+  conInIx_ = intrIx_ = syscallIx_ = 0;
+
+  // Every instruction is a replay: Interrupts come from the log only.
+  logInputs_ = replayingInputs_ = true;
+  revHighWater_ = ~uint64_t(0);
   return true;
 }
 
 
 template <typename URV>
 bool
-Hart<URV>::runUntilAddress(size_t address, FILE* traceFile)
+Hart<URV>::replayInterrupt(FILE* traceFile, std::string& instStr)
 {
-  struct timeval t0;
-  gettimeofday(&t0, nullptr);
-
-  uint64_t limit = instCountLim_;
-  uint64_t counter0 = instCounter_;
-
-  // Setup signal handlers. Restore on destruction.
-  SignalHandlers handlers;
-
-  bool success = untilAddress(address, traceFile);
-      
-  if (instCounter_ == limit)
-    std::cerr << "Stopped -- Reached instruction limit\n";
-  else if (pc_ == address)
-    std::cerr << "Stopped -- Reached end address\n";
-
-  // Simulator stats.
-  struct timeval t1;
-  gettimeofday(&t1, nullptr);
-  double elapsed = (double(t1.tv_sec - t0.tv_sec) +
-		    double(t1.tv_usec - t0.tv_usec)*1e-6);
+  if (intrIx_ >= intrLog_.size() or intrLog_.at(intrIx_).tag_ != instCounter_)
+    return false;
 
-  uint64_t numInsts = instCounter_ - counter0;
+  const InterruptLogEntry& entry = intrLog_.at(intrIx_++);
+  csRegs_.poke(CsrNumber::MIP, entry.mip_);
+  if (entry.nmi_)
+    initiateNmi(entry.cause_, pc_);
+  else
+    {
+      initiateInterrupt(InterruptCause(entry.cause_), pc_);
+      ++cycleCount_;
+    }
 
-  reportInstsPerSec(numInsts, elapsed, userStop);
-  return success;
+  uint32_t inst = 0; // Load interrupted inst.
+  readInst(currPc_, inst);
+  if (traceFile)  // Trace interrupted instruction.
+    printInstTrace(inst, instCounter_, instStr, traceFile, true);
+  return true;
 }
 
 
@@ -4730,7 +6470,7 @@ Hart<URV>::simpleRun()
               break;
             }
 
-          if (hasLim)
+          if (hasLim and not fastLoopBail_)
             std::cerr << "Stopped -- Reached instruction limit\n";
           break;
         }
@@ -4746,29 +6486,84 @@ Hart<URV>::simpleRun()
 }
 
 
+/// Fetch/decode unless match in decode cache. Without address
+/// translation (machine mode or no supervisor extension) a decode
+/// cache hit needs no fetch. With translation, a hit also skips the
+/// fetch (translation and permission checks) if the fetch of the same
+/// page was already checked in the same privilege mode: Privilege
+/// changes are caught by the mode comparison and translation changes
+/// (satp, sfence.vma, PMP, decode cache flush) reset the checked page.
+/// An instruction that may cross a page boundary is always fetched.
+template <typename URV>
+inline
+bool
+Hart<URV>::simpleFetchDecode(DecodedInst*& di)
+{
+  uint32_t ix = (pc_ >> 1) & decodeCacheMask_;
+  di = &decodeCache_[ix];
+  bool hit = di->isValid() and di->address() == pc_;
+
+  // Stop address and breakpoints are never cached: Checked on a miss.
+  if (not hit and isFlaggedPc(pc_))
+    {
+      --instCounter_;
+      fastLoopBail_ = true;
+      return false;
+    }
+
+  if (privMode_ == PrivilegeMode::Machine or not rvs_)
+    {
+      if (hit)
+        return true;
+      uint32_t inst = 0;
+      if (not fetchInst(pc_, inst))
+        return false;
+      decode(pc_, inst, *di);
+      return true;
+    }
+
+  URV page = pc_ >> 12;
+  if (hit and page == fetchCheckedPage_ and privMode_ == fetchCheckedPriv_
+      and (pc_ & 0xfff) <= 0xffc)
+    return true;
+
+  uint32_t inst = 0;
+  if (not fetchInst(pc_, inst))
+    return false;
+
+  // Same virtual address may now map to a different instruction.
+  uint32_t mask = (inst & 3) == 3 ? ~uint32_t(0) : 0xffff;
+  if (not hit or ((di->inst() ^ inst) & mask) != 0)
+    decode(pc_, inst, *di);
+
+  fetchCheckedPage_ = page;
+  fetchCheckedPriv_ = privMode_;
+  return true;
+}
+
+
 template <typename URV>
 bool
 Hart<URV>::simpleRunWithLimit()
 {
+  bool counters = lazyPerfCounters_;
   uint64_t limit = instCountLim_;
-  while (noUserStop and instCounter_ < limit) 
+  while (noUserStop and not fastLoopBail_ and instCounter_ < limit)
     {
       currPc_ = pc_;
       ++instCounter_;
 
-      // Fetch/decode unless match in decode cache.
-      uint32_t ix = (pc_ >> 1) & decodeCacheMask_;
-      DecodedInst* di = &decodeCache_[ix];
-      if (not di->isValid() or di->address() != pc_)
-        {
-          uint32_t inst = 0;
-          if (not fetchInst(pc_, inst))
-            continue;
-          decode(pc_, inst, *di);
-        }
+      DecodedInst* di = nullptr;
+      if (not simpleFetchDecode(di))
+        continue;
 
       pc_ += di->instSize();
+      if (counters)
+        hasException_ = hasInterrupt_ = false;
       execute(di);
+      hwLoopBackEdge(currPc_, di->instSize());
+      if (counters)
+        deferPerformanceCounters(*di);
     }
   return true;
 }
@@ -4778,24 +6573,23 @@ template <typename URV>
 bool
 Hart<URV>::simpleRunNoLimit()
 {
-  while (noUserStop) 
+  bool counters = lazyPerfCounters_;
+  while (noUserStop and not fastLoopBail_)
     {
       currPc_ = pc_;
       ++instCounter_;
 
-      // Fetch/decode unless match in decode cache.
-      uint32_t ix = (pc_ >> 1) & decodeCacheMask_;
-      DecodedInst* di = &decodeCache_[ix];
-      if (not di->isValid() or di->address() != pc_)
-        {
-          uint32_t inst = 0;
-          if (not fetchInst(pc_, inst))
-            continue;
-          decode(pc_, inst, *di);
-        }
+      DecodedInst* di = nullptr;
+      if (not simpleFetchDecode(di))
+        continue;
 
       pc_ += di->instSize();
+      if (counters)
+        hasException_ = hasInterrupt_ = false;
       execute(di);
+      hwLoopBackEdge(currPc_, di->instSize());
+      if (counters)
+        deferPerformanceCounters(*di);
     }
 
   return true;
@@ -4869,12 +6663,21 @@ Hart<URV>::run(FILE* file)
 
   // To run fast, this method does not do much besides
   // straight-forward execution. If any option is turned on, we switch
-  // to runUntilAdress which supports all features.
+  // to runUntilAdress which supports all features. Supervisor mode
+  // and virtual memory do not need the slow loop: Traps, privilege
+  // changes and translated loads/stores are handled by the execute
+  // methods and translated fetches by simpleFetchDecode. Neither do
+  // the stop address and breakpoints: They are never in the decode
+  // cache and are checked by simpleFetchDecode on a miss.
   URV stopAddr = stopAddrValid_? stopAddr_ : ~URV(0); // ~URV(0): No-stop PC.
   bool hasClint = clintStart_ < clintLimit_;
-  bool complex = (stopAddrValid_ or instFreq_ or enableTriggers_ or enableGdb_
-                  or enableCounters_ or alarmInterval_ or file or enableWideLdSt_
-                  or hasClint or isRvs());
+  // The interrupt replay below steps over the stop address and the
+  // breakpoints: The full loop honors them.
+  bool replayStops = replayingInputs_ and (stopAddrValid_ or not breakpoints_.empty());
+  bool complex = (replayStops or instFreq_ or enableTriggers_ or enableGdb_
+                  or (enableCounters_ and perModeCounters_) or alarmInterval_
+                  or file or enableWideLdSt_ or hasClint or statsSnapInterval_
+                  or enableEnergy_);
   if (complex)
     return runUntilAddress(stopAddr, file); 
 
@@ -4886,7 +6689,98 @@ Hart<URV>::run(FILE* file)
   // Setup signal handlers. Restore on destruction.
   SignalHandlers handlers;
 
-  bool success = simpleRun();
+  fastLoopBail_ = false;
+  setRunStopAddress(stopAddr);
+
+  // Performance counters: The simple run loops count the events of
+  // each instruction in perfEventCount_ (see deferPerformanceCounters).
+  lazyPerfCounters_ = enableCounters_;
+  if (lazyPerfCounters_)
+    definePerfLdStEvents();
+
+  // Replaying recorded inputs: The fast loop does not take
+  // interrupts. Run up to the last logged one taking each at its
+  // recorded instruction count.
+  bool success = true, done = false;
+  if (replayingInputs_ and intrIx_ < intrLog_.size())
+    {
+      try
+        {
+          replayTo(std::min(intrLog_.back().tag_, instCountLim_));
+        }
+      catch (const CoreException& ce)
+        {
+          success = logStop(ce, 0, nullptr);
+          fastLoopBail_ = false;
+          done = true;
+        }
+    }
+
+  // The fast loop stops on a flagged pc or when an interrupt becomes
+  // takeable (including one pending on entry). In the latter case,
+  // take the interrupt and resume the fast loop. Resuming at a
+  // breakpoint: Step over it, otherwise the run would stop again
+  // without progress.
+  bool step = (hasBreakpoint(pc_) and pc_ != stopAddr and
+               instCounter_ < instCountLim_);
+  if (not done and not step)
+    checkFastLoopBail();
+  while (not done)
+    {
+      if (step)
+        {
+          // Take a pending interrupt or execute the instruction at pc
+          // bypassing the decode cache (pc may be a breakpoint).
+          step = false;
+          try
+            {
+              std::string instStr;
+              currPc_ = pc_;
+              hasInterrupt_ = hasException_ = false;
+              ++instCounter_;
+              uint32_t inst = 0;
+              if (not processExternalInterrupt(nullptr, instStr) and
+                  fetchInst(pc_, inst))
+                {
+                  DecodedInst di;
+                  decode(pc_, inst, di);
+                  pc_ += di.instSize();
+                  execute(&di);
+                  hwLoopBackEdge(currPc_, di.instSize());
+                  if (lazyPerfCounters_)
+                    deferPerformanceCounters(di);
+                }
+            }
+          catch (const CoreException& ce)
+            {
+              success = logStop(ce, instCounter_, nullptr);
+              break;
+            }
+        }
+
+      success = simpleRun();
+      if (not success or not fastLoopBail_ or userStop or isFlaggedPc(pc_)
+          or instCounter_ >= instCountLim_)
+        break;
+      fastLoopBail_ = false;
+      step = true;
+    }
+
+  if (fastLoopBail_)
+    {
+      fastLoopBail_ = false;
+      if (instCounter_ == instCountLim_)
+        std::cerr << "Stopped -- Reached instruction limit\n";
+      else if (pc_ == stopAddr)
+        std::cerr << "Stopped -- Reached end address\n";
+      else if (hasBreakpoint(pc_))
+        std::cerr << "Stopped -- Reached breakpoint\n";
+    }
+  setRunStopAddress(~URV(0));
+  flushOutputBuffer();
+
+  lazyPerfCounters_ = false;
+  materializePerfCounters();
 
   // Simulator stats.
   struct timeval t1;
@@ -4895,6 +6789,9 @@ Hart<URV>::run(FILE* file)
 		    double(t1.tv_usec - t0.tv_usec)*1e-6);
 
   uint64_t numInsts = instCounter_ - counter0;
+  lastRunInsts_ = numInsts;
+  lastRunSeconds_ = elapsed;
+
   reportInstsPerSec(numInsts, elapsed, userStop);
   return success;
 }
@@ -4903,6 +6800,24 @@ Hart<URV>::run(FILE* file)
 template <typename URV>
 bool
 Hart<URV>::isInterruptPossible(InterruptCause& cause)
+{
+  if (not isInterruptTakeable(cause))
+    return false;
+
+  if (cause == InterruptCause::M_TIMER and alarmInterval_ > 0)
+    {
+      // Reset the timer-interrupt pending bit.
+      URV mip = csRegs_.peekMip();
+      mip = mip & ~(URV(1) << unsigned(cause));
+      pokeCsr(CsrNumber::MIP, mip);
+    }
+  return true;
+}
+
+
+template <typename URV>
+bool
+Hart<URV>::isInterruptTakeable(InterruptCause& cause)
 {
   if (debugMode_ and not debugStepMode_)
     return false;
@@ -4934,12 +6849,6 @@ Hart<URV>::isInterruptPossible(InterruptCause& cause)
         if (mie & mask & mip)
           {
             cause = ic;
-            if (ic == IC::M_TIMER and alarmInterval_ > 0)
-              {
-                // Reset the timer-interrupt pending bit.
-                mip = mip & ~mask;
-                pokeCsr(CsrNumber::MIP, mip);
-              }
             return true;
           }
     }
@@ -4996,9 +6905,15 @@ Hart<URV>::processExternalInterrupt(FILE* traceFile, std::string& instStr)
   if (debugStepMode_ and not dcsrStepIe_)
     return false;
 
+  // Replaying (reverse execution): Take the logged interrupts only.
+  if (instCounter_ <= revHighWater_)
+    return replayInterrupt(traceFile, instStr);
+
   // If a non-maskable interrupt was signaled by the test-bench, take it.
   if (nmiPending_)
     {
+      if (logInputs_ or recordFile_)
+        logInterrupt(URV(nmiCause_), true);
       initiateNmi(URV(nmiCause_), pc_);
       nmiPending_ = false;
       nmiCause_ = NmiCause::UNKNOWN;
@@ -5013,6 +6928,9 @@ Hart<URV>::processExternalInterrupt(FILE* traceFile, std::string& instStr)
   InterruptCause cause;
   if (isInterruptPossible(cause))
     {
+      if (logInputs_ or recordFile_)
+        logInterrupt(URV(cause), false);
+
       // Attach changes to interrupted instruction.
       initiateInterrupt(cause, pc_);
       uint32_t inst = 0; // Load interrupted inst.
@@ -5056,6 +6974,7 @@ Hart<URV>::invalidateDecodeCache()
 {
   for (auto& entry : decodeCache_)
     entry.invalidate();
+  fetchCheckedPage_ = ~URV(0);
 }
 
 
@@ -5165,6 +7084,8 @@ Hart<URV>::singleStep(FILE* traceFile)
 	  return;
 	}
 
+      hwLoopBackEdge(currPc_, di.instSize());
+
       if (minstretEnabled() and not ebreakInstDebug_)
         ++retiredInsts_;
 
@@ -6033,17 +7954,12 @@ Hart<URV>::execute(const DecodedInst* di)
      &&vsxei32_v,
      &&vsxei64_v,
 
-/* INSERT YOUR CODE FROM HERE */ 
-     //Expland
-     &&cube,
-     &&rotleft,
-     &&rotright,
-     &&reverse,
-     &&notand,
-     &&extend1,
-     &&extend2,
-     &&extend3,
-/* INSERT YOUR CODE END HERE */ 
+     &&lp_setup,
+
+     // Custom instructions (see CustomInsts.def).
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) &&id,
+#include "CustomInsts.def"
+#undef CUSTOM_INST
 
     };
 
@@ -6204,41 +8120,12 @@ Hart<URV>::execute(const DecodedInst* di)
   execAnd(di);
   return;
 
-/* INSERT YOUR CODE FROM HERE */ 
-
- cube:
-  execCube(di);
-  return;
-
-  rotleft:
-  execRotleft(di);
-  return;
-
-  rotright:
-  execRotright(di);
-  return;
-
-  reverse:
-  execReverse(di);
-  return;
-
-  notand:
-  execNotand(di);
-  return;
-  
-  extend1:
-  execExtend1(di);
-  return;
-  
-  extend2:
-  execExtend2(di);
-  return;
-  
-  extend3:
-  execExtend3(di);
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+ id:                                                                    \
+  exec##Name(di);                                                       \
   return;
-
-/* INSERT YOUR CODE END HERE */  
+#include "CustomInsts.def"
+#undef CUSTOM_INST
 
  fence:
   execFence(di);
@@ -8202,6 +10089,10 @@ Hart<URV>::execute(const DecodedInst* di)
   execVsxei64_v(di);
   return;
 
+ lp_setup:
+  execLp_setup(di);
+  return;
+
 }
 
 
@@ -8210,23 +10101,8 @@ void
 Hart<URV>::enableInstructionFrequency(bool b)
 {
   instFreq_ = b;
-  if (b)
-    {
-      instProfileVec_.resize(size_t(InstId::maxId) + 1);
-
-      auto regCount = intRegCount();
-      for (auto& inst : instProfileVec_)
-	{
-	  inst.destRegFreq_.resize(regCount);
-          inst.srcRegFreq_.resize(3);  // Up to 3 source operands
-          for (auto& vec : inst.srcRegFreq_)
-            vec.resize(regCount);
-
-          inst.srcHisto_.resize(3);  // Up to 3 source historgrams
-          for (auto& vec : inst.srcHisto_)
-            vec.resize(13);  // FIX: avoid magic 13
-	}
-    }
+  if (b and instProfiles_.empty())
+    instProfiles_.reset(unsigned(intRegCount()));
 }
 
 
@@ -8644,7 +10520,17 @@ Hart<URV>::execEcall(const DecodedInst*)
 
   if (newlib_ or linux_ or syscallSlam_)
     {
-      URV a0 = syscall_.emulate();
+      // With reverse execution or input recording, writes go through
+      // emulateSyscall to be logged.
+      if (bufferOutput_)
+        {
+          if (not syscallSlam_ and not logInputs_ and not recordFile_ and
+              bufferWriteSyscall())
+            return;
+          flushOutputBuffer();  // Keep order with other host input/output.
+        }
+
+      URV a0 = emulateSyscall();
       intRegs_.write(RegA0, a0);
       if (not syscallSlam_)
         return;
@@ -8736,6 +10622,7 @@ Hart<URV>::execSfence_vma(const DecodedInst* di)
 
   // Invalidate whole TLB. This is overkill. TBD FIX: Improve.
   virtMem_.tlb_.invalidate();
+  fetchCheckedPage_ = ~URV(0);
 
   // std::cerr << "sfence.vma " << di->op1() << ' ' << di->op2() << '\n';
   if (di->op1() == 0)
@@ -8792,6 +10679,7 @@ Hart<URV>::execMret(const DecodedInst* di)
       
   // Update privilege mode.
   privMode_ = savedMode;
+  checkFastLoopBail();
 }
 
 
@@ -8863,6 +10751,7 @@ Hart<URV>::execSret(const DecodedInst* di)
 
   // Update privilege mode.
   privMode_ = savedMode;
+  checkFastLoopBail();
 }
 
 
@@ -8930,6 +10819,9 @@ template <typename URV>
 bool
 Hart<URV>::doCsrRead(const DecodedInst* di, CsrNumber csr, URV& value)
 {
+  if (perfPending_)
+    materializePerfCounters();
+
   if (csr == CsrNumber::SATP and privMode_ == PrivilegeMode::Supervisor)
     {
       URV status = csRegs_.peekMstatus();
@@ -8948,6 +10840,12 @@ Hart<URV>::doCsrRead(const DecodedInst* di, CsrNumber csr, URV& value)
         return false;
       }
 
+  if (isShaStateCsr(csr) and not isCustomOpEnabled(CustomOp::sharound))
+    {
+      illegalInst(di);
+      return false;
+    }
+
   if (csRegs_.read(csr, privMode_, value))
     return true;
 
@@ -9005,6 +10903,12 @@ Hart<URV>::doCsrWrite(const DecodedInst* di, CsrNumber csr, URV csrVal,
         return;
       }
 
+  if (isShaStateCsr(csr) and not isCustomOpEnabled(CustomOp::sharound))
+    {
+      illegalInst(di);
+      return;
+    }
+
   // Make auto-increment happen before CSR write for minstret and cycle.
   if (csr == CsrNumber::MINSTRET or csr == CsrNumber::MINSTRETH)
     if (minstretEnabled())
@@ -9024,8 +10928,11 @@ Hart<URV>::doCsrWrite(const DecodedInst* di, CsrNumber csr, URV csrVal,
   // event reg is written.
   if (enableCounters_)
     if (csr >= CsrNumber::MHPMEVENT3 and csr <= CsrNumber::MHPMEVENT31)
-      if (not csRegs_.applyPerfEventAssign())
-        std::cerr << "Unexpected applyPerfAssign fail\n";
+      {
+        if (not csRegs_.applyPerfEventAssign())
+          std::cerr << "Unexpected applyPerfAssign fail\n";
+        definePerfLdStEvents();
+      }
 
   if (csr == CsrNumber::DCSR)
     {
@@ -9047,6 +10954,8 @@ Hart<URV>::doCsrWrite(const DecodedInst* di, CsrNumber csr, URV csrVal,
     updateAddressTranslation();
   else if (csr == CsrNumber::FCSR or csr == CsrNumber::FRM or csr == CsrNumber::FFLAGS)
     markFsDirty(); // Update FS field of MSTATS if FCSR is written
+  else if (hasCustomEnCsr_ and csr == customEnCsr_)
+    updateCustomOpMask();
 
   // Update cached values of MSTATUS MPP and MPRV.
   if (csr == CsrNumber::MSTATUS or csr == CsrNumber::SSTATUS)
@@ -9062,6 +10971,8 @@ Hart<URV>::doCsrWrite(const DecodedInst* di, CsrNumber csr, URV csrVal,
   // Same for mcycle.
   if (csr == CsrNumber::MCYCLE or csr == CsrNumber::MCYCLEH)
     cycleCount_--;
+
+  checkFastLoopBail();
 }
 
 
@@ -9312,6 +11223,8 @@ Hart<URV>::wideStore(URV addr, URV storeVal)
 
   // Enable when bench is ready.
   uint64_t val = (uint64_t(upper) << 32) | lower;
+  if (revInterval_)
+    saveCheckpointPages(addr, sizeof(val));
   if (not memory_.write(hartIx_, addr, val))
     {
       auto cause = ExceptionCause::STORE_ACC_FAULT;
@@ -9444,9 +11357,11 @@ Hart<URV>::determineStoreException(uint32_t rs1, URV base, uint64_t& addr,
   if (pmpEnabled_)
     {
       Pmp pmp = pmpManager_.accessPmp(addr);
+      pmpChecks_[PmpWrite]++;
       if (not pmp.isWrite(privMode_, mstatusMpp_, mstatusMprv_) and
           not isAddrMemMapped(addr))
         {
+          pmpDenied_[PmpWrite]++;
           secCause = SecondaryCause::STORE_ACC_PMP;
           return ExceptionCause::STORE_ACC_FAULT;
         }
@@ -10101,6 +12016,45 @@ Hart<URV>::execBbarrier(const DecodedInst* di)
 }
 
 
+/// lp.setup L, rs1, uimm: Set up hardware loop L (0 or 1). The loop
+/// body goes from the instruction following lp.setup up to (not
+/// including) the address pc + 2*uimm and runs rs1 times. A count of
+/// zero is the same as one. The loop-back is done by the run loops
+/// (hwLoopBackEdge) after the last instruction of the body retires: It
+/// is not an instruction, it is not traced (the next trace record is
+/// that of the first instruction of the body), it does not count as a
+/// retired instruction and the lpcount update is not reported as a CSR
+/// change. A trap or a trigger on the last instruction suppresses the
+/// loop-back; the instruction-address triggers of the first body
+/// instruction are checked as for any other fetch. Branching to the
+/// end address or out of the body leaves the loop active. Like the
+/// instructions of CustomInsts.def, lp.setup is illegal while
+/// disabled in the custom instruction enable mask.
+template <typename URV>
+void
+Hart<URV>::execLp_setup(const DecodedInst* di)
+{
+  if (not isCustomOpEnabled(CustomOp::lp_setup))
+    {
+      illegalInst(di);
+      return;
+    }
+
+  unsigned ix = di->op0();
+  URV start = currPc_ + di->instSize();
+  URV end = currPc_ + (URV(di->op2()) << 1);
+  if (end <= start)
+    {
+      illegalInst(di);
+      return;
+    }
+
+  lpStart_[ix] = start;
+  lpEnd_[ix] = end;
+  lpCount_[ix] = intRegs_.read(di->op1());
+}
+
+
 template
 bool
 WdRiscv::Hart<uint32_t>::store<uint32_t>(uint32_t, uint32_t, uint32_t, uint32_t);
@@ -17,8 +17,10 @@
 
 #include <cstdint>
 #include <vector>
+#include <array>
 #include <iosfwd>
 #include <unordered_set>
+#include <unordered_map>
 #include <type_traits>
 #include <functional>
 #include <atomic>
@@ -29,7 +31,9 @@
 #include "FpRegs.hpp"
 #include "VecRegs.hpp"
 #include "Memory.hpp"
-#include "InstProfile.hpp"
+#include "InstProfileArena.hpp"
+#include "StatsRegistry.hpp"
+#include "EnergyModel.hpp"
 #include "DecodedInst.hpp"
 #include "Syscall.hpp"
 #include "PmpManager.hpp"
@@ -380,6 +384,62 @@ namespace WdRiscv
     /// print run-time and instructions per second.
     bool untilAddress(size_t address, FILE* file = nullptr);
 
+    /// Differential checker: Run this hart in the fast (decode-cache)
+    /// loop in lockstep with the given reference hart which is
+    /// advanced one instruction at a time using singleStep. The
+    /// reference hart must be configured like this hart and must
+    /// have its own copy of memory loaded with the same program.
+    /// Every interval instructions compare the architectural state
+    /// (pc, integer/floating point registers and non-counter CSRs)
+    /// of the two harts. On the first mismatch, print the
+    /// differences together with the last window instructions
+    /// executed by the reference hart on the given file and return
+    /// false. Return true if both harts stop in the same state.
+    bool runLockstep(Hart<URV>& ref, uint64_t interval, unsigned window,
+                     FILE* out);
+
+    /// Enable reverse execution (gdb reverse-step/reverse-continue):
+    /// Every interval instructions, the full run loop (runUntilAddress,
+    /// used in gdb mode) takes an in-memory checkpoint of the
+    /// registers, the CSRs and the memory pages written since, keeping
+    /// the latest maxCount checkpoints. Console input, interrupts and
+    /// the results of the system calls are logged so that replaying
+    /// from a checkpoint is exact. Replayed instructions have no host
+    /// side effects: Their system calls are not emulated again and
+    /// their console-io output is dropped. An interval of zero
+    /// disables reverse execution.
+    void enableReverseExecution(uint64_t interval, unsigned maxCount = 64);
+
+    /// Go back one instruction: Restore the nearest earlier checkpoint
+    /// and replay forward in the fast loop. Return false if at the
+    /// oldest checkpoint (nothing to go back to).
+    bool reverseStep();
+
+    /// Go back to the latest earlier point where the pc was at a
+    /// breakpoint (see setBreakpoint). If there is none, go back to
+    /// the oldest checkpoint and return false.
+    bool reverseContinue();
+
+    /// Record the external inputs of this hart (console input,
+    /// results of all the system calls with the memory written by
+    /// read, pread64, readlinkat, getcwd, gettimeofday,
+    /// clock_gettime, times, uname and the status calls fstat,
+    /// fstatat, stat and lstat, interrupts and NMIs) with their
+    /// instruction counts in the given binary file. The file is
+    /// written as the run proceeds and is owned by the caller. A null
+    /// file stops recording.
+    void recordInputs(FILE* file)
+    { recordFile_ = file; recordTag_ = 0; if (file) writeInputLogHeader(); }
+
+    /// Load the inputs recorded (see recordInputs) in the given file
+    /// and feed them back during the following run instead of reading
+    /// them from the host: Console input comes from the file, the
+    /// system calls are not emulated (except for the writes to stdout
+    /// and stderr which are redone) and interrupts are taken
+    /// exactly where they were recorded (and nowhere else), in
+    /// either run loop. Return false if the file is not valid.
+    bool replayInputs(FILE* file);
+
     /// Define the program counter value at which the run method will
     /// stop.
     void setStopAddress(URV address)
@@ -389,6 +449,28 @@ namespace WdRiscv
     void clearStopAddress()
     { stopAddrValid_ = false; }
 
+    /// Set a breakpoint at the given address: The run loops stop
+    /// before executing the instruction at that address (in gdb mode,
+    /// control goes to gdb instead and the instruction then
+    /// executes). Like the stop address, breakpoints cost nothing per
+    /// instruction: The instruction at a breakpoint is never kept in
+    /// the decode cache, so only a decode cache miss needs to check
+    /// for them, and they survive decode cache invalidation.
+    void setBreakpoint(URV address)
+    { breakpoints_.insert(address); invalidateDecodeCache(address, 4); }
+
+    /// Remove the breakpoint at the given address (see setBreakpoint).
+    void clearBreakpoint(URV address)
+    { breakpoints_.erase(address); }
+
+    /// Remove all breakpoints.
+    void clearBreakpoints()
+    { breakpoints_.clear(); }
+
+    /// Return true if there is a breakpoint at the given address.
+    bool hasBreakpoint(URV address) const
+    { return not breakpoints_.empty() and breakpoints_.count(address); }
+
     /// Define the memory address corresponding to console io. Reading
     /// (lw/lh/lb) or writing (sw/sh/sb) from/to that address
     /// reads/writes a byte to/from the console.
@@ -408,6 +490,24 @@ namespace WdRiscv
     void setConsoleOutput(FILE* out)
     { consoleOut_ = out; }
 
+    /// Coalesce console-io output bytes and emulated write system
+    /// calls to stdout/stderr in a per-hart buffer instead of doing a
+    /// host write per byte/call. The buffer is flushed (at a newline
+    /// boundary when possible) once it holds limit bytes, on program
+    /// exit or write to tohost, at the end of a run, and before any
+    /// other host input/output done on behalf of the target program.
+    void enableOutputBuffering(bool flag, size_t limit = 4096)
+    {
+      if (not flag)
+        flushOutputBuffer();
+      bufferOutput_ = flag;
+      outBufLimit_ = limit;
+    }
+
+    /// Write to the host any output pending in the per-hart output
+    /// buffer (see enableOutputBuffering).
+    void flushOutputBuffer();
+
     /// If a console io memory mapped location is defined then put its
     /// address in address and return true; otherwise, return false
     /// leaving address unmodified.
@@ -838,6 +938,44 @@ namespace WdRiscv
     /// Print collected load-reserve/store-conditional stats on the given file.
     void reportLrScStat(FILE* file) const;
 
+    /// Load the energy table (see EnergyModel) from the given file
+    /// and enable energy estimation: The energy of each retired
+    /// instruction (and of its data memory access) is accumulated in
+    /// total and per function. Energy estimation requires the slow
+    /// run loop (runUntilAddress). Return true on success.
+    bool loadEnergyTable(const std::string& path);
+
+    /// Print the accumulated energy estimate (total, per function and,
+    /// if hashedBytes is non-zero, per hashed byte) on the given file.
+    void reportEnergy(FILE* file, uint64_t hashedBytes = 0) const
+    { energyModel_.report(file, hashedBytes); }
+
+    /// Dump all the collected statistics (run, instruction frequency,
+    /// trap, load-reserve/store-conditional, pmp and performance
+    /// counter stats) to the given file in the given machine readable
+    /// format.
+    void dumpStats(FILE* file, StatsRegistry::Format format);
+
+    /// Enable periodic statistics snapshots: Every interval retired
+    /// instructions, write a single record of the statistics tagged
+    /// with the instruction count to the given file. An interval of
+    /// zero disables snapshots. Snapshots require the slow run loop
+    /// (runUntilAddress).
+    void enableStatsSnapshots(FILE* file, StatsRegistry::Format format,
+                              uint64_t interval)
+    {
+      statsSnapFile_ = file;
+      statsSnapFormat_ = format;
+      statsSnapInterval_ = file ? interval : 0;
+      nextStatsSnap_ = instCounter_ + statsSnapInterval_;
+    }
+
+    /// Return the statistics registry of this hart. This allows a
+    /// caller to register additional statistics to be dumped with
+    /// the hart statistics.
+    StatsRegistry& statsRegistry()
+    { defineStats(); return stats_; }
+
     /// Reset trace data (items changed by the execution of an
     /// instruction.)
     void clearTraceData();
@@ -850,7 +988,17 @@ namespace WdRiscv
     /// Enable performance counters (count up for some enabled
     /// performance counters when their events do occur).
     void enablePerformanceCounters(bool flag)
-    { enableCounters_ = flag;  }
+    {
+      enableCounters_ = flag;
+      definePerfInstEvents();
+    }
+
+    /// Bring the performance counters (mhpmcounter CSRs) up to date
+    /// with the events deferred by run or runUntilAddress. Counter
+    /// values obtained with peekCsr during such a run may be stale
+    /// until this is called. This is done automatically before CSR
+    /// instructions, on pokeCsr and at the end of each run.
+    void materializePerfCounters();
 
     /// Enable gdb-mode.
     void enableGdb(bool flag)
@@ -1187,7 +1335,7 @@ namespace WdRiscv
 
     /// Enable per-privilege-mode performance-counter control.
     void enablePerModeCounterControl(bool flag)
-    { csRegs_.enablePerModeCounterControl(flag); }
+    { csRegs_.enablePerModeCounterControl(flag); perModeCounters_ = flag; }
 
     /// Invalidate whole cache.
     void invalidateDecodeCache();
@@ -1256,10 +1404,50 @@ namespace WdRiscv
     void enableWideLoadStore(bool flag)
     { enableWideLdSt_ = flag; }
 
+    /// Enable/disable sloppy memory accesses: Loads and stores go
+    /// straight to memory (see fastLoad/fastStore) skipping address
+    /// translation, PMA/PMP checks, misalignment, triggers, the load
+    /// queue and decode cache invalidation. For trusted batch runs of
+    /// well-behaved programs; leave disabled when debugging. Takes
+    /// effect at the next load/store. Defaults to enabled in builds
+    /// defining FAST_SLOPPY.
+    void enableSloppyMemory(bool flag)
+    { sloppyMem_ = flag; }
+
+    /// Return true if sloppy memory accesses are enabled.
+    bool isSloppyMemory() const
+    { return sloppyMem_; }
+
     /// Enable bbarrier (bus barrier) custom instruction.
     void enableBusBarrier(bool flag)
     { enableBbarrier_ = flag; }
 
+    /// Return true if given CSR is one of the SHA-256 working-state
+    /// CSRs sha_a to sha_h (0x7d8 to 0x7df) updated by the sharound
+    /// custom instruction. They are accessible only while sharound is
+    /// enabled (see setCustomOpMask).
+    static bool isShaStateCsr(CsrNumber csr)
+    { return unsigned(csr) >= shaStateCsr0 and unsigned(csr) < shaStateCsr0 + 8; }
+
+    /// Enable/disable the custom instructions of CustomInsts.def: Bit
+    /// i of the mask corresponds to the ith instruction of that
+    /// file. A disabled instruction takes an illegal instruction trap
+    /// (the trap handler may then emulate it in software). All the
+    /// custom instructions are enabled by default. If the
+    /// configuration defines a CSR named mcustomen, the mask is also
+    /// set from that CSR on reset and whenever the CSR is written.
+    void setCustomOpMask(uint64_t mask)
+    { customOpMask_ = mask; }
+
+    /// Return the custom instruction enable mask (see setCustomOpMask).
+    uint64_t customOpMask() const
+    { return customOpMask_; }
+
+    /// Return the bit of the custom instruction with the given
+    /// mnemonic in the custom instruction enable mask. Return -1 if
+    /// there is no such custom instruction.
+    static int customOpIndex(const std::string& mnemonic);
+
     /// Unpack the memory protection information defined by the given
     /// physical memory protection entry (entry 0 corresponds to
     /// PMPADDR0, ... 15 o PMPADDR15). Return true on success setting
@@ -1370,6 +1558,41 @@ namespace WdRiscv
     /// present.
     bool simpleRunNoLimit();
 
+    /// Helper to the simple run loops: Set di to the decoded
+    /// instruction at the current pc. Return false if the fetch took
+    /// an exception (pc is then that of the trap handler) or if the pc
+    /// is flagged (see isFlaggedPc) in which case the loops stop.
+    bool simpleFetchDecode(DecodedInst*& di);
+
+    /// Return true if the run loops must look at the given pc before
+    /// executing it: Stop address of the current run or breakpoint.
+    /// Instructions at those addresses are never decode cache hits.
+    bool isFlaggedPc(URV pc) const
+    { return pc == runStopAddr_ or hasBreakpoint(pc); }
+
+    /// Make given address the stop address of the current run (~0 for
+    /// none) and make sure it is not in the decode cache.
+    void setRunStopAddress(URV address)
+    {
+      runStopAddr_ = address;
+      if (address != ~URV(0))
+        invalidateDecodeCache(address, 4);
+    }
+
+    /// The simple run loops do not take interrupts. Called on entry
+    /// to the simple run loops and after a change that may make an
+    /// interrupt takeable (CSR write, mret, sret): If a non-maskable
+    /// interrupt is pending or if an interrupt can be taken now, make
+    /// the simple run loops stop so that run takes the interrupt.
+    void checkFastLoopBail()
+    {
+      if (debugStepMode_ and not dcsrStepIe_)
+        return;
+      InterruptCause cause;
+      if (nmiPending_ or isInterruptTakeable(cause))
+        fastLoopBail_ = true;
+    }
+
     /// Helper to decode. Used for compressed instructions.
     const InstEntry& decode16(uint16_t inst, uint32_t& op0, uint32_t& op1,
 			      uint32_t& op2);
@@ -1479,7 +1702,13 @@ namespace WdRiscv
     template<typename LOAD_TYPE>
     bool load(uint32_t rd, uint32_t rs1, int32_t imm);
 
-    /// For use by performance model. 
+    /// Helper to load: Load into rd from the given virtual address
+    /// computed from the given base (value of register rs1). This is
+    /// also used by the custom indexed load instructions.
+    template<typename LOAD_TYPE>
+    bool loadAt(uint32_t rd, uint32_t rs1, URV base, uint64_t virtAddr);
+
+    /// Sloppy variant of load (see enableSloppyMemory).
     template<typename LOAD_TYPE>
     bool fastLoad(uint32_t rd, uint32_t rs1, int32_t imm);
 
@@ -1497,7 +1726,7 @@ namespace WdRiscv
     template<typename STORE_TYPE>
     bool store(uint32_t rs1, URV base, URV addr, STORE_TYPE value);
 
-    /// For use by performance model. 
+    /// Sloppy variant of store (see enableSloppyMemory).
     template<typename STORE_TYPE>
     bool fastStore(uint32_t rs1, URV base, URV addr, STORE_TYPE value);
 
@@ -1509,6 +1738,25 @@ namespace WdRiscv
 					   STORE_TYPE& storeVal,
                                            SecondaryCause& secCause, bool& forced);
 
+    /// Helper to the custom lwm instruction: Load count (1 to 8)
+    /// consecutive words starting at the given virtual address into
+    /// registers rd to rd+count-1 (sign extended). All the words are
+    /// checked for exceptions and triggers before any register is
+    /// written: On a fault, no register is modified and the exception
+    /// reports the address of the first faulting word. Each register
+    /// gets its own load-queue entry. Return true on success.
+    bool loadMultiple(uint32_t rd, uint32_t rs1, URV base, uint64_t virtAddr,
+                      unsigned count);
+
+    /// Helper to the custom swm instruction: Store the low words of
+    /// registers rs to rs+count-1 at count (1 to 8) consecutive words
+    /// starting at the given virtual address. As with loadMultiple, the
+    /// whole range is checked first: On a fault, memory is not
+    /// modified. Writes to the console-io location are not echoed.
+    /// Return true on success.
+    bool storeMultiple(uint32_t rs, uint32_t rs1, URV base, uint64_t virtAddr,
+                       unsigned count);
+
     /// Helper to execLr. Load type must be int32_t, or int64_t.
     /// Return true if instruction is successful. Return false if an
     /// exception occurs or a trigger is tripped. If successful,
@@ -1620,6 +1868,35 @@ namespace WdRiscv
     // using this method.
     void updatePerformanceCountersForCsr(const DecodedInst& di);
 
+    /// Lazy variant of updatePerformanceCounters: Record the retired
+    /// instruction and its dynamic events. The counters are updated
+    /// later by materializePerfCounters.
+    void deferPerformanceCounters(const DecodedInst& di);
+
+    /// Fill perfInstEvent_ with the event associated with the class of
+    /// each instruction (done once, see deferPerformanceCounters).
+    void definePerfInstEvents();
+
+    /// Set perfLdStEvents_ to true if some mhpmevent CSR selects a bus
+    /// or a misaligned load/store event: Those cost a lookup per
+    /// load/store and are counted only when assigned to a counter.
+    void definePerfLdStEvents();
+
+    /// Register the hart statistics in stats_. The fixed ones are
+    /// registered on first use. The instruction frequency and energy
+    /// ones are registered again whenever those options were turned
+    /// on or off since the last call.
+    void defineStats();
+
+    /// Helper to defineStats: Register the statistics that do not
+    /// depend on options (run, trap, lr/sc, pmp, performance
+    /// counters).
+    void defineFixedStats();
+
+    /// Write a statistics snapshot to the snapshot file and schedule
+    /// the next one.
+    void takeStatsSnapshot();
+
     /// Fetch an instruction. Return true on success. Return false on
     /// fail (in which case an exception is initiated). May fetch a
     /// compressed instruction (16-bits) in which case the upper 16
@@ -1734,6 +2011,11 @@ namespace WdRiscv
     /// interrupt.
     bool isInterruptPossible(InterruptCause& cause);
 
+    /// Same as isInterruptPossible but without side effects: Return
+    /// true if an interrupt is pending, enabled and may be taken in
+    /// the current privilege mode. Set cause to the interrupt.
+    bool isInterruptTakeable(InterruptCause& cause);
+
     /// Return true if given address is an idempotent region of
     /// memory.
     bool isAddrIdempotent(size_t addr) const;
@@ -1779,6 +2061,104 @@ namespace WdRiscv
     /// the stop.
     bool logStop(const CoreException& ce, uint64_t instCount, FILE* traceFile);
 
+    /// Helper to runLockstep: Compare the architectural state of this
+    /// hart to that of the given hart printing differences on the
+    /// given file. Return the number of differences.
+    unsigned compareArchState(const Hart<URV>& other, FILE* out) const;
+
+    /// Helper to the reverse execution methods: Append a checkpoint of
+    /// the current state, dropping the oldest one if there are too
+    /// many, and schedule the next one.
+    void takeCheckpoint();
+
+    /// Helper to the reverse execution methods: Return to the state of
+    /// the checkpoint at the given index dropping all later ones.
+    void restoreCheckpoint(size_t ix);
+
+    /// Helper to the store methods: Preserve, in the latest checkpoint,
+    /// the content of the pages covering the given address range
+    /// unless already done since that checkpoint was taken.
+    void saveCheckpointPages(uint64_t addr, unsigned size);
+
+    /// Helper to the reverse execution methods: Run forward until the
+    /// instruction count reaches target, taking the logged interrupts
+    /// and checkpoints on the way. Return the latest instruction count
+    /// at which the pc was at a breakpoint or ~0 if none.
+    uint64_t replayTo(uint64_t target);
+
+    /// Read a console input character. With reverse execution, read
+    /// from the input log when replaying and log what is read
+    /// otherwise.
+    int readConsoleInput();
+
+    /// Helper to processExternalInterrupt: Log (see
+    /// enableReverseExecution and recordInputs) an interrupt about to
+    /// be taken.
+    void logInterrupt(URV cause, bool nmi);
+
+    /// Helper to execEcall: Emulate the system call in a7. With
+    /// reverse execution or input recording, log its result and the
+    /// memory written by an input system call, or reproduce them from
+    /// the log when replaying. Return the value of a0.
+    URV emulateSyscall();
+
+    /// Return true if the current instruction is re-executed by a
+    /// reverse execution replay: Its host side effects (system calls,
+    /// console-io output) were already done.
+    bool isReExecuting() const
+    { return instCounter_ <= reExecHighWater_; }
+
+    /// Write the header of the input record file.
+    void writeInputLogHeader();
+
+    /// Write the header of an input record of the given kind (see
+    /// InputKind) tagged with the current instruction count.
+    void writeInputRecord(unsigned kind);
+
+    /// Helper to processExternalInterrupt: Take the logged interrupt
+    /// of the current instruction count (if any) of a replay. Return
+    /// true if an interrupt was taken.
+    bool replayInterrupt(FILE* traceFile, std::string& instStr);
+
+    /// Append the given bytes destined to the given host stream to the
+    /// output buffer flushing as needed.
+    void bufferOutput(FILE* out, const char* data, size_t size);
+
+    /// Helper to execEcall: Emulate a write system call to
+    /// stdout/stderr by appending to the output buffer. Return true
+    /// on success. Return false if the call must go through the
+    /// system call emulator.
+    bool bufferWriteSyscall();
+
+    /// Helper to emulateSyscall: Perform a read or write system call
+    /// on a standard stream (not redirected) or a read, write,
+    /// pread64 or pwrite64 on a file opened on the host by the system
+    /// call emulator (see hostFds_) directly on the host descriptor,
+    /// moving the data between the host and guest memory in bulk. Set
+    /// ret to the value of a0 and return true on success. Return
+    /// false if the call must go through the system call emulator.
+    bool fastSyscall(URV& ret);
+
+    /// Helper to emulateSyscall: Perform the system call in a7 on the
+    /// host using fastSyscall if possible and the system call
+    /// emulator otherwise, keeping track of the descriptors opened
+    /// and closed. Return the value of a0.
+    URV hostSyscall();
+
+    /// Helper to hostSyscall: Add given descriptor, just returned by
+    /// an open of the path at the given guest address relative to
+    /// dirFd, to hostFds_ if it is the host descriptor of that file.
+    void noteHostFd(URV fd, SRV dirFd, uint64_t pathAddr);
+
+    /// Copy size bytes of guest memory at addr to the given host
+    /// buffer a word at a time. No translation, no PMA checks.
+    void copyFromGuest(uint64_t addr, uint8_t* buf, size_t size);
+
+    /// Copy size bytes of the given host buffer to guest memory at
+    /// addr a word at a time invalidating overlapping decode cache
+    /// entries and reservations. No translation, no PMA checks.
+    void copyToGuest(uint64_t addr, const uint8_t* buf, size_t size);
+
     /// Return true if minstret is enabled (not inhibited by mcountinhibit).
     bool minstretEnabled() const
     { return prevPerfControl_ & 0x4; }
@@ -1844,16 +2224,55 @@ namespace WdRiscv
     void execOr(const DecodedInst*);
     void execAnd(const DecodedInst*);
 
-/* INSERT YOUR CODE FROM HERE */  
-    void execCube(const DecodedInst*);
-    void execRotleft(const DecodedInst*);
-    void execRotright(const DecodedInst*);
-    void execReverse(const DecodedInst*);
-    void execNotand(const DecodedInst*);
-    void execExtend1(const DecodedInst*);
-    void execExtend2(const DecodedInst*);
-    void execExtend3(const DecodedInst*);
-/* INSERT YOUR CODE END HERE */  
+    // Custom instructions (see CustomInsts.def).
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+    void exec##Name(const DecodedInst*);
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+
+    /// Index of each custom instruction in CustomInsts.def (bit
+    /// position in the custom instruction enable mask). The
+    /// hand-defined lp.setup takes the bit following the table.
+    enum class CustomOp
+      {
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) id,
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+       lp_setup,
+       count
+      };
+
+    /// Return true if the given custom instruction is enabled.
+    bool isCustomOpEnabled(CustomOp op) const
+    { return (customOpMask_ >> unsigned(op)) & 1; }
+
+    /// Set the custom instruction enable mask from the mcustomen CSR.
+    void updateCustomOpMask();
+
+    /// Do one SHA-256 compression round on the working-state CSRs
+    /// with the given message schedule word and the round constant of
+    /// index kIx (modulo 64). Record the eight CSRs as written (for the
+    /// trace) and return the new value of a.
+    URV shaRound(URV w, URV kIx);
+
+    /// Hardware loop back-edge (see execLp_setup): Called after the
+    /// instruction at instPc of the given size retires. If that
+    /// instruction is the last of an active hardware loop and it fell
+    /// through (no taken branch or trap), decrement the loop count and
+    /// continue at the loop start if the count is still non-zero. Loop
+    /// 0 is checked first: It is the inner loop when both loops end at
+    /// the same address.
+    void hwLoopBackEdge(URV instPc, unsigned instSize)
+    {
+      if ((lpCount_[0] | lpCount_[1]) == 0 or pc_ != instPc + instSize)
+        return;
+      for (unsigned i = 0; i < 2; ++i)
+        if (lpCount_[i] and pc_ == lpEnd_[i] and --lpCount_[i])
+          {
+            pc_ = lpStart_[i];
+            return;
+          }
+    }
 
     void execFence(const DecodedInst*);
     void execFencei(const DecodedInst*);
@@ -2115,6 +2534,7 @@ namespace WdRiscv
     void execLoad64(const DecodedInst*);
     void execStore64(const DecodedInst*);
     void execBbarrier(const DecodedInst*);
+    void execLp_setup(const DecodedInst*);
 
     // Return true if maskable instruction is legal. Take an illegal instuction
     // exception and return false otherwise.
@@ -2876,6 +3296,51 @@ namespace WdRiscv
 
     void loadQueueCommit(const DecodedInst&);
 
+    /// Reverse execution checkpoint (see enableReverseExecution).
+    struct Checkpoint
+    {
+      uint64_t tag_ = 0;         // Instruction count.
+      uint64_t retired_ = 0;
+      uint64_t cycles_ = 0;
+      uint64_t alarmLimit_ = 0;
+      URV pc_ = 0;
+      PrivilegeMode priv_ = PrivilegeMode::Machine;
+      std::vector<URV> intRegs_;
+      std::vector<uint64_t> fpRegs_;
+      std::vector<std::pair<CsrNumber, URV>> csrs_;
+      size_t conInIx_ = 0;       // Position in console input log.
+      size_t intrIx_ = 0;        // Position in interrupt log.
+      size_t syscallIx_ = 0;     // Position in system call log.
+
+      // Content (at tag_) of the pages written since: Page number to
+      // bytes.
+      std::unordered_map<uint64_t, std::vector<uint8_t>> pages_;
+    };
+
+    /// Interrupt taken while recording (see enableReverseExecution).
+    struct InterruptLogEntry
+    {
+      uint64_t tag_ = 0;   // Instruction count.
+      URV cause_ = 0;
+      URV mip_ = 0;        // Value of MIP when taken.
+      bool nmi_ = false;
+    };
+
+    /// System call (see recordInputs).
+    struct SyscallLogEntry
+    {
+      uint64_t tag_ = 0;   // Instruction count.
+      URV ret_ = 0;        // Value of a0 after the call.
+      uint64_t addr_ = 0;  // Address of the memory written by the call.
+      std::vector<uint8_t> data_;  // Bytes written by the call.
+    };
+
+    /// Kinds of PMP checked access (see pmpChecks_).
+    enum PmpAccess { PmpRead = 0, PmpWrite = 1, PmpExec = 2 };
+
+    /// Kinds of records in an input record file.
+    enum InputKind { ConsoleIn = 0, Interrupt = 1, Nmi = 2, Syscall = 3 };
+
     /// Save snapshot of registers (PC, integer, floating point, CSR) into file
     bool saveSnapshotRegs(const std::string& path);
 
@@ -2989,6 +3454,14 @@ namespace WdRiscv
 
     bool instFreq_ = false;         // Collection instruction frequencies.
     bool enableCounters_ = false;   // Enable performance monitors.
+    bool perModeCounters_ = false;  // Per privilege mode counter control.
+
+    // Deferred performance counter events (see materializePerfCounters).
+    bool lazyPerfCounters_ = false;        // True if counter updates deferred.
+    bool perfPending_ = false;             // True if some updates deferred.
+    bool perfLdStEvents_ = false;          // True if bus/misalign ld/st events counted.
+    std::vector<uint8_t> perfInstEvent_;   // Class event of each InstId.
+    std::array<uint64_t, size_t(EventNumber::_End)> perfEventCount_{};  // Pending counts.
     bool enableTriggers_ = false;   // Enable debug triggers.
     bool enableGdb_ = false;        // Enable gdb mode.
     int gdbTcpPort_ = -1;           // Enable gdb mode.
@@ -3033,19 +3506,93 @@ namespace WdRiscv
     unsigned mxlen_ = 8*sizeof(URV);
     FILE* consoleOut_ = nullptr;
 
+    // Output buffering (see enableOutputBuffering).
+    bool bufferOutput_ = false;     // True if output buffering enabled.
+    size_t outBufLimit_ = 4096;     // Flush threshold of output buffer.
+    std::string outBuf_;            // Pending output bytes.
+    std::vector<uint8_t> syscallBuf_;  // Host side of fastSyscall transfers.
+    std::unordered_set<URV> hostFds_;  // Guest descriptors same as host ones.
+    FILE* outBufFile_ = nullptr;    // Destination of pending output bytes.
+    unsigned redirectedFds_ = 0;    // Bit i set if file descriptor i redirected.
+
     // Stack access control.
     bool checkStackAccess_ = false;
     URV stackMax_ = ~URV(0);
     URV stackMin_ = 0;
 
     bool enableWideLdSt_ = false;   // True if wide (64-bit) ld/st enabled.
+#ifdef FAST_SLOPPY
+    bool sloppyMem_ = true;         // See enableSloppyMemory.
+#else
+    bool sloppyMem_ = false;        // See enableSloppyMemory.
+#endif
     bool wideLdSt_ = false;         // True if executing wide ld/st instrution.
     bool enableBbarrier_ = false;
 
+    uint64_t customOpMask_ = ~uint64_t(0);  // Custom instruction enable mask.
+    bool hasCustomEnCsr_ = false;           // True if mcustomen CSR defined.
+    CsrNumber customEnCsr_ = CsrNumber::MAX_CSR_;  // Number of mcustomen CSR.
+
+    // Hardware loops (lp.setup). Tied to the lpstart0/lpend0/lpcount0
+    // and lpstart1/lpend1/lpcount1 CSRs (0x7e4 to 0x7e9). A loop is
+    // active while its count is non-zero.
+    URV lpStart_[2] = { 0, 0 };
+    URV lpEnd_[2] = { 0, 0 };
+    URV lpCount_[2] = { 0, 0 };
+
+    // SHA-256 working-state accelerator (see shaRound). Tied to the
+    // sha_a..sha_h CSRs.
+    static constexpr unsigned shaStateCsr0 = 0x7d8;
+    URV shaState_[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    // Virtual page (pc >> 12) and privilege mode of the last fetch
+    // checked by simpleFetchDecode under address translation. Reset on
+    // satp, sfence.vma, PMP changes and decode cache flush.
+    URV fetchCheckedPage_ = ~URV(0);
+    PrivilegeMode fetchCheckedPriv_ = PrivilegeMode::Machine;
+    bool fastLoopBail_ = false;  // Simple run loops must stop (see checkFastLoopBail).
+
+    URV runStopAddr_ = ~URV(0);       // Stop address of the current run.
+    std::unordered_set<URV> breakpoints_;  // See setBreakpoint.
+
+    // Reverse execution (see enableReverseExecution).
+    uint64_t revInterval_ = 0;                // Insts between checkpoints (0: off).
+    uint64_t nextCheckpoint_ = ~uint64_t(0);  // Inst count of next checkpoint.
+    uint64_t revHighWater_ = 0;               // Insts up to this count are replays.
+    uint64_t reExecHighWater_ = 0;            // Insts up to this count are re-executed.
+    unsigned maxCheckpoints_ = 64;
+    std::vector<Checkpoint> checkpoints_;
+    std::vector<int> conInLog_;               // Console input characters.
+    size_t conInIx_ = 0;                      // Next console input log position.
+    std::vector<InterruptLogEntry> intrLog_;
+    size_t intrIx_ = 0;                       // Next interrupt log position.
+    std::vector<SyscallLogEntry> syscallLog_;
+    size_t syscallIx_ = 0;                    // Next system call log position.
+    bool logInputs_ = false;                  // Keep the logs above.
+    bool replayingInputs_ = false;            // Logs loaded by replayInputs.
+    FILE* recordFile_ = nullptr;              // See recordInputs.
+    uint64_t recordTag_ = 0;                  // Tag of last record written.
+
     int gdbInputFd_ = -1;  // Input file descriptor when running in gdb mode.
 
     InstTable instTable_;
-    std::vector<InstProfile> instProfileVec_; // Instruction frequency
+    InstProfileArena instProfiles_; // Instruction frequency
+
+    // Machine readable statistics (see dumpStats).
+    StatsRegistry stats_;
+    bool statsDefined_ = false;          // Fixed statistics registered.
+    unsigned statsLayout_ = 0;           // Optional statistics registered.
+    std::array<uint64_t, 3> pmpChecks_{};   // PMP checks by PmpAccess.
+    std::array<uint64_t, 3> pmpDenied_{};   // PMP denials by PmpAccess.
+    FILE* statsSnapFile_ = nullptr;      // Destination of periodic snapshots.
+    StatsRegistry::Format statsSnapFormat_ = StatsRegistry::Format::Json;
+    uint64_t statsSnapInterval_ = 0;     // Instructions between snapshots.
+    uint64_t nextStatsSnap_ = 0;         // Instruction count of next snapshot.
+    uint64_t lastRunInsts_ = 0;          // Instructions executed by last run.
+    double lastRunSeconds_ = 0;          // Elapsed time of last run.
+
+    EnergyModel energyModel_;            // Energy estimation.
+    bool enableEnergy_ = false;          // True if energy table loaded.
 
     std::vector<uint64_t> interruptStat_;  // Count of different types of interrupts.
 
@@ -41,6 +41,33 @@ InstEntry::InstEntry(std::string name, InstId id,
 }
 
 
+// Instruction type and load/store size of each operand form of the
+// custom instructions (see CustomInsts.def).
+#define CUSTOM_TYPE_R3   InstType::Int
+#define CUSTOM_TYPE_R2   InstType::Int
+#define CUSTOM_TYPE_R3D  InstType::Int
+#define CUSTOM_TYPE_LDW  InstType::Load
+#define CUSTOM_TYPE_STW  InstType::Store
+#define CUSTOM_TYPE_LDM  InstType::Load
+#define CUSTOM_TYPE_STM  InstType::Store
+
+#define CUSTOM_LOAD_SIZE_R3   0
+#define CUSTOM_LOAD_SIZE_R2   0
+#define CUSTOM_LOAD_SIZE_R3D  0
+#define CUSTOM_LOAD_SIZE_LDW  4
+#define CUSTOM_LOAD_SIZE_STW  0
+#define CUSTOM_LOAD_SIZE_LDM  4
+#define CUSTOM_LOAD_SIZE_STM  0
+
+#define CUSTOM_STORE_SIZE_R3   0
+#define CUSTOM_STORE_SIZE_R2   0
+#define CUSTOM_STORE_SIZE_R3D  0
+#define CUSTOM_STORE_SIZE_LDW  0
+#define CUSTOM_STORE_SIZE_STW  4
+#define CUSTOM_STORE_SIZE_LDM  0
+#define CUSTOM_STORE_SIZE_STM  4
+
+
 InstTable::InstTable()
 {
   setupInstVec();
@@ -106,6 +133,15 @@ InstTable::InstTable()
   instVec_.at(size_t(InstId::c_fswsp)) .setStoreSize(4);
   instVec_.at(size_t(InstId::c_sdsp))  .setStoreSize(8);
 
+  // Set data size of custom load/store instructions.
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+  if (CUSTOM_LOAD_SIZE_##form)                                          \
+    instVec_.at(size_t(InstId::id)).setLoadSize(CUSTOM_LOAD_SIZE_##form); \
+  if (CUSTOM_STORE_SIZE_##form)                                         \
+    instVec_.at(size_t(InstId::id)).setStoreSize(CUSTOM_STORE_SIZE_##form);
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+
   // Mark conditional branch instructions.
   instVec_.at(size_t(InstId::beq))    .setConditionalBranch(true);
   instVec_.at(size_t(InstId::bne))    .setConditionalBranch(true);
@@ -3886,56 +3922,90 @@ InstTable::setupInstVec()
         OperandType::IntReg, OperandMode::Read, rs1Mask,
       },
 
-/* INSERT YOUR CODE FROM HERE */
-
-      { "cube", InstId::cube, 0x4000033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
-
-      { "rotleft", InstId::rotleft, 0x4001033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
-
-      { "rotright", InstId::rotright, 0x4002033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
-
-      { "reverse", InstId::reverse, 0x4003033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
-
-      { "notand", InstId::notand, 0x4004033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
-	
-      { "extend1", InstId::extend1, 0x4005033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
-	
-      { "extend2", InstId::extend2, 0x40006033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
-
-      { "extend3", InstId::extend3, 0x4007033, top7Funct3Low7Mask,
-	InstType::Int,
-	OperandType::IntReg, OperandMode::Write, rdMask,
-	OperandType::IntReg, OperandMode::Read, rs1Mask,
-	OperandType::IntReg, OperandMode::Read, rs2Mask },
+      // Custom instruction: lp.setup L, rs1, uimm (hardware loop L).
+      { "lp.setup", InstId::lp_setup,
+        0b000000000000'00000'100'00000'1111011,
+        0b000000000000'00000'111'11110'1111111,
+        InstType::Int,
+        OperandType::Imm, OperandMode::None, rdMask,
+        OperandType::IntReg, OperandMode::Read, rs1Mask,
+        OperandType::Imm, OperandMode::None, immTop12 },
 
-/* INSERT YOUR CODE END HERE */ 
+      // Custom instructions (see CustomInsts.def).
+#define CUSTOM_MASK_R3  top7Funct3Low7Mask
+#define CUSTOM_OPERANDS_R3                                      \
+        OperandType::IntReg, OperandMode::Write, rdMask,        \
+        OperandType::IntReg, OperandMode::Read, rs1Mask,        \
+        OperandType::IntReg, OperandMode::Read, rs2Mask
+#define CUSTOM_MASK_R2  (top7Funct3Low7Mask | rs2Mask)
+#define CUSTOM_OPERANDS_R2                                      \
+        OperandType::IntReg, OperandMode::Write, rdMask,        \
+        OperandType::IntReg, OperandMode::Read, rs1Mask
+#define CUSTOM_MASK_R3D  top7Funct3Low7Mask
+#define CUSTOM_OPERANDS_R3D                                     \
+        OperandType::IntReg, OperandMode::ReadWrite, rdMask,    \
+        OperandType::IntReg, OperandMode::Read, rs1Mask,        \
+        OperandType::IntReg, OperandMode::Read, rs2Mask
+#define CUSTOM_MASK_LDW  top7Funct3Low7Mask
+#define CUSTOM_OPERANDS_LDW  CUSTOM_OPERANDS_R3
+#define CUSTOM_MASK_STW  top7Funct3Low7Mask
+#define CUSTOM_OPERANDS_STW                                     \
+        OperandType::IntReg, OperandMode::Read, rdMask,         \
+        OperandType::IntReg, OperandMode::Read, rs1Mask,        \
+        OperandType::IntReg, OperandMode::Read, rs2Mask
+#define CUSTOM_MASK_LDM  top7Funct3Low7Mask
+#define CUSTOM_OPERANDS_LDM                                     \
+        OperandType::IntReg, OperandMode::Write, rdMask,        \
+        OperandType::IntReg, OperandMode::Read, rs1Mask,        \
+        OperandType::Imm, OperandMode::None, rs2Mask
+#define CUSTOM_MASK_STM  top7Funct3Low7Mask
+#define CUSTOM_OPERANDS_STM                                     \
+        OperandType::IntReg, OperandMode::Read, rdMask,         \
+        OperandType::IntReg, OperandMode::Read, rs1Mask,        \
+        OperandType::Imm, OperandMode::None, rs2Mask
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+      { mnemonic, InstId::id,                                           \
+        ((funct7) << 25) | ((funct3) << 12) | (opcode),                 \
+        CUSTOM_MASK_##form,                                             \
+        CUSTOM_TYPE_##form,                                             \
+        CUSTOM_OPERANDS_##form },
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+#undef CUSTOM_OPERANDS_STM
+#undef CUSTOM_MASK_STM
+#undef CUSTOM_OPERANDS_LDM
+#undef CUSTOM_MASK_LDM
+#undef CUSTOM_OPERANDS_STW
+#undef CUSTOM_MASK_STW
+#undef CUSTOM_OPERANDS_LDW
+#undef CUSTOM_MASK_LDW
+#undef CUSTOM_OPERANDS_R3D
+#undef CUSTOM_MASK_R3D
+#undef CUSTOM_OPERANDS_R2
+#undef CUSTOM_MASK_R2
+#undef CUSTOM_OPERANDS_R3
+#undef CUSTOM_MASK_R3
     };
 }
+
+#undef CUSTOM_STORE_SIZE_STM
+#undef CUSTOM_STORE_SIZE_LDM
+#undef CUSTOM_STORE_SIZE_STW
+#undef CUSTOM_STORE_SIZE_LDW
+#undef CUSTOM_STORE_SIZE_R3D
+#undef CUSTOM_STORE_SIZE_R2
+#undef CUSTOM_STORE_SIZE_R3
+#undef CUSTOM_LOAD_SIZE_STM
+#undef CUSTOM_LOAD_SIZE_LDM
+#undef CUSTOM_LOAD_SIZE_STW
+#undef CUSTOM_LOAD_SIZE_LDW
+#undef CUSTOM_LOAD_SIZE_R3D
+#undef CUSTOM_LOAD_SIZE_R2
+#undef CUSTOM_LOAD_SIZE_R3
+#undef CUSTOM_TYPE_STM
+#undef CUSTOM_TYPE_LDM
+#undef CUSTOM_TYPE_STW
+#undef CUSTOM_TYPE_LDW
+#undef CUSTOM_TYPE_R3D
+#undef CUSTOM_TYPE_R2
+#undef CUSTOM_TYPE_R3
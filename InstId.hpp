@@ -629,19 +629,16 @@ namespace WdRiscv
      vsxei32_v,
      vsxei64_v,
 
-/* INSERT YOUR CODE FROM HERE */
-     // Expland
-     cube,
-     rotleft,
-     rotright,
-     reverse,
-     notand,
-     extend1,
-     extend2,
-     extend3,
-
-/* INSERT YOUR CODE END HERE */ 
-
-     maxId = extend3
+     // Custom hardware loop setup.
+     lp_setup,
+
+     // Custom instructions (see CustomInsts.def).
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) id,
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+
+     idLimit,  // Not an instruction: One past the last id.
+
+     maxId = idLimit - 1
     };
 }
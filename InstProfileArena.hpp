@@ -0,0 +1,178 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "InstId.hpp"
+
+
+namespace WdRiscv
+{
+
+  /// Instruction profiles (frequency, privilege, register and
+  /// operand value histograms) of all the instructions kept in one
+  /// contiguous allocation: A fixed size block of 64-bit counters
+  /// per instruction id. Blocks are a multiple of 64 bytes and the
+  /// first one starts on a 64-byte boundary, so that each block
+  /// starts on a cache line. A block is laid out as follows:
+  ///
+  ///   header    : freq, user, supervisor, machine, hasImm, minImm, maxImm
+  ///   rd        : destination register frequencies
+  ///   rs1..rs3  : source register frequencies
+  ///   histo1..3 : source operand value histograms
+  ///   immHisto  : immediate operand value histogram
+  class InstProfileArena
+  {
+  public:
+
+    /// Maximum number of source register operands.
+    static constexpr unsigned maxSources = 3;
+
+    /// Number of counters in a histogram (13 buckets padded to 16).
+    static constexpr unsigned histoSize = 16;
+
+    /// Allocate zeroed profiles for all instruction ids for a hart
+    /// with the given number of registers.
+    void reset(unsigned regCount)
+    {
+      regCount_ = regCount;
+      destOffset_ = headerSize;
+      srcOffset_ = destOffset_ + regCount;
+      histoOffset_ = srcOffset_ + maxSources*regCount;
+      immOffset_ = histoOffset_ + maxSources*histoSize;
+      blockSize_ = (immOffset_ + histoSize + 7) & ~size_t(7);
+      count_ = size_t(InstId::maxId) + 1;
+
+      // Over-allocate by a block minus one counter to start the
+      // first block on a 64-byte boundary.
+      data_.assign(blockSize_ * count_ + 7, 0);
+      uintptr_t addr = reinterpret_cast<uintptr_t>(data_.data());
+      base_ = ((64 - (addr & 63)) & 63) / sizeof(uint64_t);
+    }
+
+    /// Return true if no profiles are allocated.
+    bool empty() const
+    { return count_ == 0; }
+
+    /// Return the number of profiles (one per instruction id).
+    size_t size() const
+    { return count_; }
+
+    /// Return the number of registers per register frequency table.
+    unsigned regCount() const
+    { return regCount_; }
+
+    /// Execution count of the given instruction.
+    uint64_t& freq(InstId id)
+    { return block(id)[0]; }
+
+    uint64_t freq(InstId id) const
+    { return block(id)[0]; }
+
+    /// Execution counts of the given instruction in user, supervisor
+    /// and machine mode.
+    uint64_t& user(InstId id)
+    { return block(id)[1]; }
+
+    uint64_t user(InstId id) const
+    { return block(id)[1]; }
+
+    uint64_t& supervisor(InstId id)
+    { return block(id)[2]; }
+
+    uint64_t supervisor(InstId id) const
+    { return block(id)[2]; }
+
+    uint64_t& machine(InstId id)
+    { return block(id)[3]; }
+
+    uint64_t machine(InstId id) const
+    { return block(id)[3]; }
+
+    /// True if the given instruction has an immediate operand.
+    bool hasImm(InstId id) const
+    { return block(id)[4]; }
+
+    /// Smallest/largest immediate value seen for given instruction.
+    int32_t minImm(InstId id) const
+    { return int32_t(block(id)[5]); }
+
+    int32_t maxImm(InstId id) const
+    { return int32_t(block(id)[6]); }
+
+    /// Record an immediate operand value of the given instruction.
+    void addImm(InstId id, int32_t imm)
+    {
+      uint64_t* b = block(id);
+      int32_t minVal = b[4] ? std::min(int32_t(b[5]), imm) : imm;
+      int32_t maxVal = b[4] ? std::max(int32_t(b[6]), imm) : imm;
+      b[4] = 1;
+      b[5] = uint32_t(minVal);
+      b[6] = uint32_t(maxVal);
+    }
+
+    /// Destination register frequencies (indexed by register number).
+    uint64_t* destRegFreq(InstId id)
+    { return block(id) + destOffset_; }
+
+    const uint64_t* destRegFreq(InstId id) const
+    { return block(id) + destOffset_; }
+
+    /// Frequencies of the register used as the ith source operand.
+    uint64_t* srcRegFreq(InstId id, unsigned i)
+    { return block(id) + srcOffset_ + i*regCount_; }
+
+    const uint64_t* srcRegFreq(InstId id, unsigned i) const
+    { return block(id) + srcOffset_ + i*regCount_; }
+
+    /// Value histogram of the ith source operand.
+    uint64_t* srcHisto(InstId id, unsigned i)
+    { return block(id) + histoOffset_ + i*histoSize; }
+
+    const uint64_t* srcHisto(InstId id, unsigned i) const
+    { return block(id) + histoOffset_ + i*histoSize; }
+
+    /// Value histogram of the immediate operand.
+    uint64_t* immHisto(InstId id)
+    { return block(id) + immOffset_; }
+
+    const uint64_t* immHisto(InstId id) const
+    { return block(id) + immOffset_; }
+
+  private:
+
+    static constexpr size_t headerSize = 8;
+
+    uint64_t* block(InstId id)
+    { return data_.data() + base_ + size_t(id) * blockSize_; }
+
+    const uint64_t* block(InstId id) const
+    { return data_.data() + base_ + size_t(id) * blockSize_; }
+
+    std::vector<uint64_t> data_;
+    size_t base_ = 0;   // Index of first block (64-byte aligned).
+    size_t count_ = 0;  // Number of blocks.
+    unsigned regCount_ = 0;
+    size_t blockSize_ = 0;
+    size_t destOffset_ = 0;
+    size_t srcOffset_ = 0;
+    size_t histoOffset_ = 0;
+    size_t immOffset_ = 0;
+  };
+
+}
@@ -0,0 +1,347 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cinttypes>
+#include "StatsRegistry.hpp"
+
+
+using namespace WdRiscv;
+
+
+void
+StatsRegistry::addCounter(const std::string& name, std::function<uint64_t()> getter,
+                          bool inSnapshot)
+{
+  Entry entry;
+  entry.name = name;
+  entry.kind = Kind::Counter;
+  entry.counter = getter;
+  entry.inSnapshot = inSnapshot;
+  entries_.push_back(entry);
+  csvHeaderDone_ = false;
+}
+
+
+void
+StatsRegistry::addValue(const std::string& name, std::function<double()> getter)
+{
+  Entry entry;
+  entry.name = name;
+  entry.kind = Kind::Value;
+  entry.value = getter;
+  entries_.push_back(entry);
+  csvHeaderDone_ = false;
+}
+
+
+void
+StatsRegistry::addHistogram(const std::string& name,
+                            const std::vector<std::string>& labels,
+                            std::function<void(std::vector<uint64_t>&)> getter,
+                            bool inSnapshot)
+{
+  Entry entry;
+  entry.name = name;
+  entry.kind = Kind::Histogram;
+  entry.histogram = getter;
+  entry.labels = labels;
+  entry.inSnapshot = inSnapshot;
+  entries_.push_back(entry);
+  csvHeaderDone_ = false;
+}
+
+
+void
+StatsRegistry::addText(const std::string& name, std::function<std::string()> getter)
+{
+  Entry entry;
+  entry.name = name;
+  entry.kind = Kind::Text;
+  entry.text = getter;
+  entries_.push_back(entry);
+}
+
+
+void
+StatsRegistry::clear()
+{
+  entries_.clear();
+  csvHeaderDone_ = false;
+}
+
+
+void
+StatsRegistry::removePrefix(const std::string& prefix)
+{
+  auto matches = [&prefix] (const Entry& entry) {
+    return entry.name.compare(0, prefix.size(), prefix) == 0;
+  };
+  size_t size = entries_.size();
+  entries_.erase(std::remove_if(entries_.begin(), entries_.end(), matches),
+                 entries_.end());
+  if (entries_.size() != size)
+    csvHeaderDone_ = false;
+}
+
+
+/// Print given string as a JSON string (quoted and escaped).
+static void
+printJsonString(FILE* out, const std::string& str)
+{
+  fputc('"', out);
+  for (char c : str)
+    {
+      if (c == '"' or c == '\\')
+        fprintf(out, "\\%c", c);
+      else if (c == '\n')
+        fputs("\\n", out);
+      else if (c == '\t')
+        fputs("\\t", out);
+      else if (static_cast<unsigned char>(c) < 0x20)
+        fprintf(out, "\\u%04x", unsigned(c));
+      else
+        fputc(c, out);
+    }
+  fputc('"', out);
+}
+
+
+/// Print given real value. Infinite and NaN values are printed as
+/// null in JSON and as an empty field in CSV.
+static void
+printReal(FILE* out, double value, bool json)
+{
+  if (std::isfinite(value))
+    fprintf(out, "%.17g", value);
+  else if (json)
+    fputs("null", out);
+}
+
+
+void
+StatsRegistry::dump(FILE* out, Format format, bool skipZero) const
+{
+  bool json = format == Format::Json;
+  const char* sep = "";
+
+  if (json)
+    fprintf(out, "{");
+
+  std::vector<uint64_t> counts;
+
+  for (const auto& entry : entries_)
+    {
+      switch (entry.kind)
+        {
+        case Kind::Counter:
+          {
+            uint64_t count = entry.counter();
+            if (skipZero and count == 0)
+              break;
+            if (json)
+              {
+                fprintf(out, "%s\n  ", sep);
+                printJsonString(out, entry.name);
+                fprintf(out, ": %" PRIu64, count);
+              }
+            else
+              fprintf(out, "%s,%" PRIu64 "\n", entry.name.c_str(), count);
+            sep = ",";
+          }
+          break;
+
+        case Kind::Value:
+          if (json)
+            {
+              fprintf(out, "%s\n  ", sep);
+              printJsonString(out, entry.name);
+              fprintf(out, ": ");
+              printReal(out, entry.value(), true);
+            }
+          else
+            {
+              fprintf(out, "%s,", entry.name.c_str());
+              printReal(out, entry.value(), false);
+              fprintf(out, "\n");
+            }
+          sep = ",";
+          break;
+
+        case Kind::Histogram:
+          {
+            counts.assign(entry.labels.size(), 0);
+            entry.histogram(counts);
+
+            bool any = false;
+            for (auto count : counts)
+              any = any or count != 0;
+            if (skipZero and not any)
+              break;
+
+            if (json)
+              {
+                fprintf(out, "%s\n  ", sep);
+                printJsonString(out, entry.name);
+                fprintf(out, ": {");
+              }
+
+            const char* bucketSep = "";
+            for (size_t i = 0; i < entry.labels.size(); ++i)
+              {
+                if (skipZero and counts.at(i) == 0)
+                  continue;
+                if (json)
+                  {
+                    fprintf(out, "%s", bucketSep);
+                    printJsonString(out, entry.labels.at(i));
+                    fprintf(out, ": %" PRIu64, counts.at(i));
+                    bucketSep = ", ";
+                  }
+                else
+                  fprintf(out, "%s.%s,%" PRIu64 "\n", entry.name.c_str(),
+                          entry.labels.at(i).c_str(), counts.at(i));
+              }
+
+            if (json)
+              fprintf(out, "}");
+            sep = ",";
+          }
+          break;
+
+        case Kind::Text:
+          {
+            std::string text = entry.text();
+            if (skipZero and text.empty())
+              break;
+            if (json)
+              {
+                fprintf(out, "%s\n  ", sep);
+                printJsonString(out, entry.name);
+                fprintf(out, ": ");
+                printJsonString(out, text);
+              }
+            else
+              {
+                // Quote the text field doubling embedded quotes.
+                fprintf(out, "%s,\"", entry.name.c_str());
+                for (char c : text)
+                  {
+                    if (c == '"')
+                      fputc('"', out);
+                    fputc(c, out);
+                  }
+                fprintf(out, "\"\n");
+              }
+            sep = ",";
+          }
+          break;
+        }
+    }
+
+  if (json)
+    fprintf(out, "\n}\n");
+  fflush(out);
+}
+
+
+void
+StatsRegistry::dumpSnapshot(FILE* out, Format format, uint64_t tag)
+{
+  bool json = format == Format::Json;
+
+  if (not json and not csvHeaderDone_)
+    {
+      fprintf(out, "tag");
+      for (const auto& entry : entries_)
+        {
+          if (not entry.inSnapshot)
+            continue;
+          if (entry.kind == Kind::Histogram)
+            for (const auto& label : entry.labels)
+              fprintf(out, ",%s.%s", entry.name.c_str(), label.c_str());
+          else if (entry.kind != Kind::Text)
+            fprintf(out, ",%s", entry.name.c_str());
+        }
+      fprintf(out, "\n");
+      csvHeaderDone_ = true;
+    }
+
+  if (json)
+    fprintf(out, "{\"tag\": %" PRIu64, tag);
+  else
+    fprintf(out, "%" PRIu64, tag);
+
+  std::vector<uint64_t> counts;
+
+  for (const auto& entry : entries_)
+    {
+      if (not entry.inSnapshot)
+        continue;
+
+      switch (entry.kind)
+        {
+        case Kind::Counter:
+          if (json)
+            {
+              fprintf(out, ", ");
+              printJsonString(out, entry.name);
+              fprintf(out, ": %" PRIu64, entry.counter());
+            }
+          else
+            fprintf(out, ",%" PRIu64, entry.counter());
+          break;
+
+        case Kind::Value:
+          if (json)
+            {
+              fprintf(out, ", ");
+              printJsonString(out, entry.name);
+              fprintf(out, ": ");
+            }
+          else
+            fprintf(out, ",");
+          printReal(out, entry.value(), json);
+          break;
+
+        case Kind::Histogram:
+          counts.assign(entry.labels.size(), 0);
+          entry.histogram(counts);
+          if (json)
+            {
+              fprintf(out, ", ");
+              printJsonString(out, entry.name);
+              fprintf(out, ": {");
+              for (size_t i = 0; i < counts.size(); ++i)
+                {
+                  fprintf(out, "%s", i ? ", " : "");
+                  printJsonString(out, entry.labels.at(i));
+                  fprintf(out, ": %" PRIu64, counts.at(i));
+                }
+              fprintf(out, "}");
+            }
+          else
+            for (auto count : counts)
+              fprintf(out, ",%" PRIu64, count);
+          break;
+
+        case Kind::Text:
+          break;
+        }
+    }
+
+  fprintf(out, json ? "}\n" : "\n");
+  fflush(out);
+}
@@ -0,0 +1,104 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <functional>
+
+
+namespace WdRiscv
+{
+
+  /// Registry of named statistics (counters, real values, histograms
+  /// and free-form text) that can be dumped in JSON or CSV format.
+  /// Statistics are registered once with a function producing their
+  /// current value; values are only computed when dumped. Names are
+  /// dot-separated paths (e.g. "inst.add.freq").
+  class StatsRegistry
+  {
+  public:
+
+    enum class Format { Json, Csv };
+
+    /// Register a counter. If inSnapshot is false, the counter is
+    /// only reported by dump (not by dumpSnapshot): This is used for
+    /// detailed statistics that would make snapshots too large.
+    void addCounter(const std::string& name, std::function<uint64_t()> getter,
+                    bool inSnapshot = true);
+
+    /// Register a real-valued statistic.
+    void addValue(const std::string& name, std::function<double()> getter);
+
+    /// Register a histogram with the given bucket labels. The getter
+    /// must produce one count per label. See addCounter for inSnapshot.
+    void addHistogram(const std::string& name, const std::vector<std::string>& labels,
+                      std::function<void(std::vector<uint64_t>&)> getter,
+                      bool inSnapshot = true);
+
+    /// Register a free-form text statistic (for reports that exist
+    /// only in text form).
+    void addText(const std::string& name, std::function<std::string()> getter);
+
+    /// Remove all registered statistics.
+    void clear();
+
+    /// Remove the statistics whose names start with the given prefix
+    /// (e.g. "inst."). The next CSV snapshot gets a new header.
+    void removePrefix(const std::string& prefix);
+
+    /// Return true if no statistic is registered.
+    bool empty() const
+    { return entries_.empty(); }
+
+    /// Dump all the statistics to the given file: A JSON object
+    /// mapping names to values (histograms are objects mapping labels
+    /// to counts) or CSV lines of the form name,value (one line per
+    /// histogram bucket with name.label as name). If skipZero is
+    /// true, omit zero counters and empty histogram buckets.
+    void dump(FILE* out, Format format, bool skipZero = true) const;
+
+    /// Streaming mode: Write a single record holding the given tag
+    /// (typically an instruction count) and all the counters, values
+    /// and histogram buckets registered with inSnapshot (text
+    /// statistics are omitted). In JSON format, this is one JSON
+    /// object per line with histograms as in dump (label to count,
+    /// all buckets). In CSV format, a header line is written before
+    /// the first record.
+    void dumpSnapshot(FILE* out, Format format, uint64_t tag);
+
+  private:
+
+    enum class Kind { Counter, Value, Histogram, Text };
+
+    struct Entry
+    {
+      std::string name;
+      Kind kind = Kind::Counter;
+      std::function<uint64_t()> counter;
+      std::function<double()> value;
+      std::function<void(std::vector<uint64_t>&)> histogram;
+      std::function<std::string()> text;
+      std::vector<std::string> labels;
+      bool inSnapshot = true;
+    };
+
+    std::vector<Entry> entries_;
+    bool csvHeaderDone_ = false;
+  };
+
+}
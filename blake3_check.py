@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+
+# Copyright 2020 Western Digital Corporation or its affiliates.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Run blake3bench under whisper, verify its digests against a host
+reference and compare its cost with sha256opt.
+
+The host reference is the blake3 python module if installed, otherwise
+blake3bench.c compiled for the host.
+
+Both costs are in retired instructions per byte. blake3bench measures
+its own (instret CSR around the hashing of full chunks). sha256opt
+hashes one line of standard input: It is run on two inputs differing
+by whole blocks and the difference of the retired counts is divided
+by the difference of the lengths, which cancels the start-up and
+output costs.
+
+Example:
+  blake3_check.py --whisper ./whisper blake3bench_custom --sha256 sha256opt
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+# sha256opt inputs: 1 and 4 blocks once padded (sha256opt reads at most
+# 255 characters).
+SHA_SHORT = 55
+SHA_LONG = 247
+
+
+def run_whisper(whisper, elf, extra, text=None):
+    """Run given program under whisper feeding it the given text on
+    standard input. Return (stdout, retired-count)."""
+    cmd = [whisper] + extra + [elf]
+    proc = subprocess.run(cmd, input=text, stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE, universal_newlines=True)
+    match = re.search(r'Retired (\d+) instruction', proc.stderr)
+    return proc.stdout, int(match.group(1)) if match else None
+
+
+def reference_digests(lengths, source):
+    """Return a dictionary mapping each of the given lengths to the
+    reference digest of the test input of that length (byte i is i % 251)."""
+    try:
+        import blake3
+        return {n: blake3.blake3(bytes(i % 251 for i in range(n))).hexdigest()
+                for n in lengths}
+    except ImportError:
+        pass
+
+    # Fall back on the benchmark compiled for the host.
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = os.path.join(tmp, 'blake3bench')
+        subprocess.check_call(['cc', '-O2', '-o', exe, source])
+        out = subprocess.run([exe], stdout=subprocess.PIPE,
+                             universal_newlines=True).stdout
+    return {int(m.group(1)): m.group(2)
+            for m in re.finditer(r'^digest\s+(\d+)\s+([0-9a-f]+)', out, re.M)}
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('blake3bench', help='blake3bench ELF file.')
+    parser.add_argument('--whisper', default='whisper',
+                        help='Path to the whisper executable.')
+    parser.add_argument('--sha256', help='sha256opt ELF file to compare with.')
+    parser.add_argument('--whisper-args', default='--newlib',
+                        help='Whisper arguments (space separated).')
+    args = parser.parse_args()
+    extra = args.whisper_args.split()
+
+    out, retired = run_whisper(args.whisper, args.blake3bench, extra)
+    digests = {int(m.group(1)): m.group(2)
+               for m in re.finditer(r'^digest\s+(\d+)\s+([0-9a-f]+)', out, re.M)}
+    if not digests:
+        sys.exit('No digest in blake3bench output')
+
+    reference = reference_digests(digests.keys(), os.path.join(here, 'blake3bench.c'))
+    errors = 0
+    for n in sorted(digests):
+        ok = reference.get(n) == digests[n]
+        errors += not ok
+        print('%-5s len %4d %s' % ('ok' if ok else 'FAIL', n, digests[n]))
+
+    if retired is not None:
+        print('blake3bench retired %d instructions' % retired)
+    match = re.search(r'insts/byte\s+([0-9.]+)', out)
+    blake_per_byte = float(match.group(1)) if match else None
+    if blake_per_byte is None:
+        print('blake3: no instructions per byte in output')
+    else:
+        print('blake3:    %8.2f instructions per byte (full chunks)' % blake_per_byte)
+
+    if args.sha256:
+        counts = []
+        for length in (SHA_SHORT, SHA_LONG):
+            _, sha_retired = run_whisper(args.whisper, args.sha256, extra,
+                                         'a' * length + '\n')
+            counts.append(sha_retired)
+        if None in counts:
+            print('sha256opt run failed')
+        else:
+            sha_per_byte = (counts[1] - counts[0]) / (SHA_LONG - SHA_SHORT)
+            print('sha256opt: %8.2f instructions per byte (%d-byte difference)'
+                  % (sha_per_byte, SHA_LONG - SHA_SHORT))
+            if blake_per_byte:
+                print('ratio sha256opt/blake3: %.2f' % (sha_per_byte / blake_per_byte))
+
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,287 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// BLAKE3 benchmark (single chunk: inputs of up to 1024 bytes) with and
+// without the axr16/axr12/axr8/axr7 custom instructions of
+// CustomInsts.def (rd = rotr(rd ^ (rs1 + rs2), N)).
+//
+//   CC="riscv32-unknown-elf-gcc -O2 -march=rv32imac -mabi=ilp32"
+//   $CC -o blake3bench blake3bench.c
+//   $CC -DUSE_CUSTOM -o blake3bench_custom blake3bench.c
+//   whisper --newlib blake3bench_custom
+//
+// The digests of the inputs of the official BLAKE3 test vectors
+// (byte i is i % 251) are printed and checked against the known
+// values. Retired instructions (instret CSR) per compression and per
+// byte are reported. blake3_check.py compares the digests with a host
+// reference and the instructions per byte with those of sha256opt.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#if defined(__riscv) && defined(USE_CUSTOM)
+
+static inline uint32_t axr16(uint32_t d, uint32_t a, uint32_t b)
+{
+  __asm__ (".insn r 0x5b, 0, 2, %0, %1, %2" : "+r"(d) : "r"(a), "r"(b));
+  return d;
+}
+
+static inline uint32_t axr12(uint32_t d, uint32_t a, uint32_t b)
+{
+  __asm__ (".insn r 0x5b, 1, 2, %0, %1, %2" : "+r"(d) : "r"(a), "r"(b));
+  return d;
+}
+
+static inline uint32_t axr8(uint32_t d, uint32_t a, uint32_t b)
+{
+  __asm__ (".insn r 0x5b, 2, 2, %0, %1, %2" : "+r"(d) : "r"(a), "r"(b));
+  return d;
+}
+
+static inline uint32_t axr7(uint32_t d, uint32_t a, uint32_t b)
+{
+  __asm__ (".insn r 0x5b, 3, 2, %0, %1, %2" : "+r"(d) : "r"(a), "r"(b));
+  return d;
+}
+
+#else
+
+static inline uint32_t rotr32(uint32_t x, unsigned n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+// rotr(d ^ (a + b), N)
+static inline uint32_t axr16(uint32_t d, uint32_t a, uint32_t b)
+{ return rotr32(d ^ (a + b), 16); }
+static inline uint32_t axr12(uint32_t d, uint32_t a, uint32_t b)
+{ return rotr32(d ^ (a + b), 12); }
+static inline uint32_t axr8(uint32_t d, uint32_t a, uint32_t b)
+{ return rotr32(d ^ (a + b), 8); }
+static inline uint32_t axr7(uint32_t d, uint32_t a, uint32_t b)
+{ return rotr32(d ^ (a + b), 7); }
+
+#endif
+
+
+static inline uint64_t instret(void)
+{
+#if defined(__riscv)
+#if __riscv_xlen == 32
+  uint32_t lo, hi, hi2;
+  do
+    {
+      __asm__ volatile ("rdinstreth %0" : "=r"(hi));
+      __asm__ volatile ("rdinstret %0" : "=r"(lo));
+      __asm__ volatile ("rdinstreth %0" : "=r"(hi2));
+    }
+  while (hi != hi2);
+  return ((uint64_t)hi << 32) | lo;
+#else
+  uint64_t count;
+  __asm__ volatile ("rdinstret %0" : "=r"(count));
+  return count;
+#endif
+#else
+  return 0;
+#endif
+}
+
+
+#define CHUNK_START 1
+#define CHUNK_END   2
+#define ROOT        8
+
+#define CHUNK_LEN 1024
+#define BLOCK_LEN 64
+
+static const uint32_t IV[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint8_t MSG_SCHEDULE[7][16] = {
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+  { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+  { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+  { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+  { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+  { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+  { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+
+// The G mixing function: Each add-xor-rotate step is a single axr
+// instruction in the custom variant. The sums are still needed by the
+// following steps, so folding them into the axr instructions saves no
+// instruction but takes the adds off the critical path: The b updates
+// use c + d directly instead of waiting for the new c.
+#define G(a, b, c, d, mx, my)                   \
+  do                                            \
+    {                                           \
+      a = a + b;                                \
+      d = axr16(d, a, (mx));                    \
+      a = a + (mx);                             \
+      b = axr12(b, c, d);                       \
+      c = c + d;                                \
+      a = a + b;                                \
+      d = axr8(d, a, (my));                     \
+      a = a + (my);                             \
+      b = axr7(b, c, d);                        \
+      c = c + d;                                \
+    }                                           \
+  while (0)
+
+
+static inline uint32_t load32(const uint8_t* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+    ((uint32_t)p[3] << 24);
+}
+
+
+static void compress(uint32_t cv[8], const uint8_t block[BLOCK_LEN],
+                     uint64_t counter, uint32_t blockLen, uint32_t flags)
+{
+  uint32_t m[16];
+  for (unsigned i = 0; i < 16; ++i)
+    m[i] = load32(block + 4*i);
+
+  uint32_t s0 = cv[0], s1 = cv[1], s2 = cv[2], s3 = cv[3];
+  uint32_t s4 = cv[4], s5 = cv[5], s6 = cv[6], s7 = cv[7];
+  uint32_t s8 = IV[0], s9 = IV[1], s10 = IV[2], s11 = IV[3];
+  uint32_t s12 = (uint32_t) counter, s13 = (uint32_t) (counter >> 32);
+  uint32_t s14 = blockLen, s15 = flags;
+
+  for (unsigned r = 0; r < 7; ++r)
+    {
+      const uint8_t* sc = MSG_SCHEDULE[r];
+      G(s0, s4, s8,  s12, m[sc[0]],  m[sc[1]]);
+      G(s1, s5, s9,  s13, m[sc[2]],  m[sc[3]]);
+      G(s2, s6, s10, s14, m[sc[4]],  m[sc[5]]);
+      G(s3, s7, s11, s15, m[sc[6]],  m[sc[7]]);
+      G(s0, s5, s10, s15, m[sc[8]],  m[sc[9]]);
+      G(s1, s6, s11, s12, m[sc[10]], m[sc[11]]);
+      G(s2, s7, s8,  s13, m[sc[12]], m[sc[13]]);
+      G(s3, s4, s9,  s14, m[sc[14]], m[sc[15]]);
+    }
+
+  cv[0] = s0 ^ s8;  cv[1] = s1 ^ s9;  cv[2] = s2 ^ s10; cv[3] = s3 ^ s11;
+  cv[4] = s4 ^ s12; cv[5] = s5 ^ s13; cv[6] = s6 ^ s14; cv[7] = s7 ^ s15;
+}
+
+
+static unsigned compressCount;
+
+
+// Hash an input of at most CHUNK_LEN bytes (a single chunk which is
+// also the root) producing a 32-byte digest.
+void blake3_chunk(const uint8_t* input, size_t len, uint8_t out[32])
+{
+  uint32_t cv[8];
+  memcpy(cv, IV, sizeof(cv));
+
+  uint32_t flags = CHUNK_START;
+  while (len > BLOCK_LEN)
+    {
+      compress(cv, input, 0, BLOCK_LEN, flags);
+      compressCount++;
+      input += BLOCK_LEN;
+      len -= BLOCK_LEN;
+      flags = 0;
+    }
+
+  uint8_t block[BLOCK_LEN];
+  memset(block, 0, sizeof(block));
+  memcpy(block, input, len);
+  compress(cv, block, 0, (uint32_t) len, flags | CHUNK_END | ROOT);
+  compressCount++;
+
+  for (unsigned i = 0; i < 8; ++i)
+    {
+      out[4*i]   = (uint8_t) cv[i];
+      out[4*i+1] = (uint8_t) (cv[i] >> 8);
+      out[4*i+2] = (uint8_t) (cv[i] >> 16);
+      out[4*i+3] = (uint8_t) (cv[i] >> 24);
+    }
+}
+
+
+struct TestVector
+{
+  size_t len;
+  const char* digest;
+};
+
+
+// From the official BLAKE3 test vectors (input byte i is i % 251).
+static const struct TestVector vectors[] = {
+  { 0,    "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" },
+  { 1,    "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213" },
+  { 64,   "4eed7141ea4a5cd4b788606bd23f46e212af9cacebacdc7d1f4c6dc7f2511b98" },
+  { 65,   "de1e5fa0be70df6d2be8fffd0e99ceaa8eb6e8c93a63f2d8d1c30ecb6b263dee" },
+  { 1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11" },
+  { 1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7" },
+};
+
+
+static uint8_t input[CHUNK_LEN];
+
+
+int main(void)
+{
+  for (size_t i = 0; i < CHUNK_LEN; ++i)
+    input[i] = (uint8_t) (i % 251);
+
+#if defined(USE_CUSTOM)
+  printf("blake3bench (custom instructions)\n");
+#else
+  printf("blake3bench (baseline)\n");
+#endif
+
+  int errors = 0;
+  for (size_t v = 0; v < sizeof(vectors)/sizeof(vectors[0]); ++v)
+    {
+      uint8_t digest[32];
+      blake3_chunk(input, vectors[v].len, digest);
+
+      char hex[65];
+      for (unsigned i = 0; i < 32; ++i)
+        sprintf(hex + 2*i, "%02x", digest[i]);
+
+      int ok = strcmp(hex, vectors[v].digest) == 0;
+      if (!ok)
+        errors++;
+      printf("digest %4u %s %s\n", (unsigned) vectors[v].len, hex, ok ? "ok" : "FAIL");
+    }
+
+  // Timed run: Hash a full chunk repeatedly.
+  unsigned reps = 16;
+  uint8_t digest[32];
+  compressCount = 0;
+  uint64_t t0 = instret();
+  for (unsigned r = 0; r < reps; ++r)
+    blake3_chunk(input, CHUNK_LEN, digest);
+  uint64_t t1 = instret();
+
+  unsigned long insts = (unsigned long) (t1 - t0);
+  printf("bytes %u  insts %lu  insts/compress %lu  insts/byte %.2f\n",
+         reps * CHUNK_LEN, insts, insts / compressCount,
+         (double) insts / (reps * CHUNK_LEN));
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// CRC32C (Castagnoli) benchmark comparing three implementations:
+//
+//   table   -- Byte at a time with a 256-entry table.
+//   clmul   -- Word at a time with a Barrett reduction using the Zbc
+//              carry-less multiply instructions (clmul, clmulr).
+//   custom  -- Word at a time with the crc32cd.w custom instruction
+//              (bytes with crc32cd.b). See CustomInsts.def.
+//
+// Build for RV32 with the Zbc and custom instructions enabled in
+// whisper and run:
+//
+//   riscv32-unknown-elf-gcc -O2 -march=rv32imac -mabi=ilp32 -o crc32c crc32c.c
+//   whisper --newlib crc32c
+//
+// Each variant is checked against the standard check value (CRC32C of
+// "123456789" is 0xe3069283) and against the table variant on a
+// buffer. Retired instructions (instret CSR) per byte are reported.
+// The program also builds on the host, where the instructions are
+// emulated in C and instruction counts are reported as zero.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#define CRC32C_POLY     0x82f63b78u  // Reflected polynomial.
+#define CRC32C_POLY_QT  0x6f5389f8u  // Reflected floor(x^64 / P), no x^32 term.
+
+
+#if defined(__riscv) && __riscv_xlen == 32
+
+static inline uint32_t clmul(uint32_t a, uint32_t b)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x33, 1, 5, %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+  return r;
+}
+
+static inline uint32_t clmulr(uint32_t a, uint32_t b)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x33, 2, 5, %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+  return r;
+}
+
+static inline uint32_t crc32cd_b(uint32_t crc, uint32_t data)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 0, 1, %0, %1, %2" : "=r"(r) : "r"(crc), "r"(data));
+  return r;
+}
+
+static inline uint32_t crc32cd_w(uint32_t crc, uint32_t data)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 2, 1, %0, %1, %2" : "=r"(r) : "r"(crc), "r"(data));
+  return r;
+}
+
+static inline uint64_t instret(void)
+{
+  uint32_t lo, hi, hi2;
+  do
+    {
+      __asm__ volatile ("rdinstreth %0" : "=r"(hi));
+      __asm__ volatile ("rdinstret %0" : "=r"(lo));
+      __asm__ volatile ("rdinstreth %0" : "=r"(hi2));
+    }
+  while (hi != hi2);
+  return ((uint64_t)hi << 32) | lo;
+}
+
+#else
+
+// Host emulation of the instructions.
+
+static inline uint32_t clmul(uint32_t a, uint32_t b)
+{
+  uint32_t r = 0;
+  for (unsigned i = 0; i < 32; ++i)
+    if ((b >> i) & 1)
+      r ^= a << i;
+  return r;
+}
+
+static inline uint32_t clmulr(uint32_t a, uint32_t b)
+{
+  uint32_t r = 0;
+  for (unsigned i = 0; i < 32; ++i)
+    if ((b >> i) & 1)
+      r ^= a >> (31 - i);
+  return r;
+}
+
+static inline uint32_t crc32cd_bits(uint32_t crc, unsigned bits)
+{
+  for (unsigned i = 0; i < bits; ++i)
+    crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+  return crc;
+}
+
+static inline uint32_t crc32cd_b(uint32_t crc, uint32_t data)
+{
+  return crc32cd_bits(crc ^ (data & 0xff), 8);
+}
+
+static inline uint32_t crc32cd_w(uint32_t crc, uint32_t data)
+{
+  return crc32cd_bits(crc ^ data, 32);
+}
+
+static inline uint64_t instret(void)
+{
+  return 0;
+}
+
+#endif
+
+
+static inline uint32_t read32(const uint8_t* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+    ((uint32_t)p[3] << 24);
+}
+
+
+static uint32_t table[256];
+
+
+static void init_table(void)
+{
+  for (uint32_t i = 0; i < 256; ++i)
+    {
+      uint32_t x = i;
+      for (unsigned j = 0; j < 8; ++j)
+        x = (x >> 1) ^ ((x & 1) ? CRC32C_POLY : 0);
+      table[i] = x;
+    }
+}
+
+
+uint32_t crc32c_table(uint32_t crc, const uint8_t* p, size_t len)
+{
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i)
+    crc = (crc >> 8) ^ table[(crc ^ p[i]) & 0xff];
+  return ~crc;
+}
+
+
+// Reduce crc ^ word by 32 bits: Barrett reduction with a carry-less
+// multiply by the quotient followed by a carry-less multiply by the
+// polynomial (bit reflected, so the high half is taken with clmulr).
+static inline uint32_t crc32c_clmul_word(uint32_t s)
+{
+  uint32_t t = clmul(s, CRC32C_POLY_QT);
+  t = (t << 1) ^ s;
+  return clmulr(t, CRC32C_POLY);
+}
+
+
+uint32_t crc32c_clmul(uint32_t crc, const uint8_t* p, size_t len)
+{
+  crc = ~crc;
+  for (; len >= 4; len -= 4, p += 4)
+    crc = crc32c_clmul_word(crc ^ read32(p));
+  for (; len; --len, ++p)
+    crc = (crc >> 8) ^ table[(crc ^ *p) & 0xff];
+  return ~crc;
+}
+
+
+uint32_t crc32c_custom(uint32_t crc, const uint8_t* p, size_t len)
+{
+  crc = ~crc;
+  for (; len >= 4; len -= 4, p += 4)
+    crc = crc32cd_w(crc, read32(p));
+  for (; len; --len, ++p)
+    crc = crc32cd_b(crc, *p);
+  return ~crc;
+}
+
+
+typedef uint32_t (*CrcFunc)(uint32_t, const uint8_t*, size_t);
+
+struct Variant
+{
+  const char* name;
+  CrcFunc func;
+};
+
+static const struct Variant variants[] = {
+  { "table",  crc32c_table },
+  { "clmul",  crc32c_clmul },
+  { "custom", crc32c_custom },
+};
+
+
+#define BUF_SIZE 8192
+
+static uint8_t buffer[BUF_SIZE];
+
+
+int main(void)
+{
+  init_table();
+
+  uint32_t x = 2020;
+  for (size_t i = 0; i < BUF_SIZE; ++i)
+    buffer[i] = (uint8_t) ((x = x * 1103515245u + 12345u) >> 16);
+
+  const char* check = "123456789";
+  uint32_t expected = crc32c_table(0, buffer, BUF_SIZE);
+  int errors = 0;
+
+  printf("%-8s %-10s %12s %10s\n", "variant", "crc", "insts", "insts/byte");
+
+  for (size_t v = 0; v < sizeof(variants)/sizeof(variants[0]); ++v)
+    {
+      const struct Variant* var = &variants[v];
+
+      uint32_t c = var->func(0, (const uint8_t*) check, strlen(check));
+      if (c != 0xe3069283u)
+        {
+          printf("FAIL %s check value 0x%08x expecting 0xe3069283\n", var->name,
+                 (unsigned) c);
+          errors++;
+        }
+
+      uint64_t t0 = instret();
+      uint32_t crc = var->func(0, buffer, BUF_SIZE);
+      uint64_t t1 = instret();
+
+      if (crc != expected)
+        {
+          printf("FAIL %s buffer crc 0x%08x expecting 0x%08x\n", var->name,
+                 (unsigned) crc, (unsigned) expected);
+          errors++;
+        }
+
+      unsigned long insts = (unsigned long) (t1 - t0);
+      printf("%-8s 0x%08x %12lu %10.2f\n", var->name, (unsigned) crc, insts,
+             (double) insts / BUF_SIZE);
+    }
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+
+# Copyright 2020 Western Digital Corporation or its affiliates.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Design-space sweep over the custom instructions of CustomInsts.def.
+
+Every benchmark is run under whisper once for each candidate set of
+custom instructions. The set is selected by the reset value of the
+mcustomen CSR (see Hart::setCustomOpMask) which is defined in a
+configuration file generated for each run. The candidate sets are
+(--mode):
+
+  group    One set per group of instructions sharing opcode and funct7
+           (default).
+  single   One set per instruction.
+  subsets  All the subsets of at most --max-ops instructions. The number
+           of runs grows quickly: It is capped by --max-runs.
+
+A disabled instruction takes an illegal instruction trap, so the
+benchmarks must either install a trap handler emulating the custom
+instructions in software or not use the disabled ones (runs that fail
+are reported as such).
+
+Sets are ranked by the number of retired instructions saved per
+custom instruction added, relative to a baseline run with all custom
+instructions disabled. Benchmarks using custom instructions without
+emulating them cannot run that way: Give, with --baseline, the same
+benchmarks built without custom instructions (e.g. sha256 for
+sha256opt), one per benchmark in the same order.
+
+Example:
+  custom_op_sweep.py --whisper ./whisper --config swerv.json -j 16 \\
+      --baseline sha256 hash_c -- sha256opt hashbench
+"""
+
+import argparse
+import concurrent.futures
+import itertools
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+def read_custom_ops(def_file):
+    """Return the (mnemonic, group) pairs of the custom instructions in
+    the order of the given CustomInsts.def file (bit order of the
+    enable mask). The group is the (opcode, funct7) pair."""
+    ops = []
+    pattern = re.compile(r'^CUSTOM_INST\(\s*\w+\s*,\s*\w+\s*,\s*"([^"]+)"\s*,'
+                         r'\s*(\w+)\s*,\s*(\w+)\s*,')
+    with open(def_file) as f:
+        for line in f:
+            match = pattern.match(line)
+            if match:
+                group = (int(match.group(2), 0), int(match.group(3), 0))
+                ops.append((match.group(1), group))
+    # Hand-defined lp.setup: Bit following the table (see the header
+    # of CustomInsts.def).
+    if ops:
+        ops.append(('lp.setup', (0x7b, None)))
+    return ops
+
+
+def make_config(base_config, csr_number, mask, width):
+    """Return the text of a whisper configuration file derived from
+    the given base configuration (a dictionary) defining the mcustomen
+    CSR with the given reset value."""
+    config = json.loads(json.dumps(base_config))
+    csrs = config.setdefault('csr', {})
+    all_ones = (1 << width) - 1
+    csrs['mcustomen'] = {'number': hex(csr_number), 'reset': hex(mask),
+                         'mask': hex(all_ones), 'exists': 'true'}
+    return json.dumps(config, indent=2)
+
+
+def run_whisper(args, base_config, mask, benchmark):
+    """Run the given benchmark with the given custom instruction enable
+    mask. Return (mask, benchmark, retired-count) where the count is
+    None if the run failed."""
+    with tempfile.NamedTemporaryFile('w', suffix='.json', delete=False) as f:
+        f.write(make_config(base_config, args.csr_number, mask, args.width))
+        config_path = f.name
+    try:
+        cmd = [args.whisper, '--configfile', config_path] + args.whisper_args
+        cmd.append(benchmark)
+        proc = subprocess.run(cmd, stdout=subprocess.DEVNULL,
+                              stderr=subprocess.PIPE, universal_newlines=True,
+                              timeout=args.timeout)
+        match = re.search(r'Retired (\d+) instruction', proc.stderr)
+        if proc.returncode != 0 or not match:
+            return mask, benchmark, None
+        return mask, benchmark, int(match.group(1))
+    except subprocess.TimeoutExpired:
+        return mask, benchmark, None
+    finally:
+        os.unlink(config_path)
+
+
+def group_masks(ops):
+    """Return one mask per (opcode, funct7) group of the given ops in
+    order of first appearance."""
+    masks = {}
+    for i, (_, group) in enumerate(ops):
+        masks[group] = masks.get(group, 0) | (1 << i)
+    return list(masks.values())
+
+
+def subset_count(count, max_size):
+    """Return the number of subsets of count items with at most
+    max_size items."""
+    total, term = 0, 1
+    for size in range(0, max_size + 1):
+        total += term
+        term = term * (count - size) // (size + 1)
+    return total
+
+
+def subsets(count, max_size):
+    """Return the masks of all the subsets of count items with at most
+    max_size items, smallest subsets first."""
+    masks = []
+    for size in range(0, max_size + 1):
+        for combo in itertools.combinations(range(count), size):
+            masks.append(sum(1 << i for i in combo))
+    return masks
+
+
+def mask_names(mask, ops):
+    names = [op for i, (op, _) in enumerate(ops) if (mask >> i) & 1]
+    return '+'.join(names) if names else '(none)'
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(
+        description='Rank subsets of the custom instructions by retired '
+        'instructions saved per instruction added.')
+    parser.add_argument('benchmarks', nargs='+',
+                        help='Benchmark ELF files.')
+    parser.add_argument('--whisper', default='whisper',
+                        help='Path to the whisper executable.')
+    parser.add_argument('--config',
+                        help='Base whisper configuration file (JSON).')
+    parser.add_argument('--defs', default=os.path.join(here, 'CustomInsts.def'),
+                        help='Custom instruction definitions file.')
+    parser.add_argument('--csr-number', type=lambda x: int(x, 0), default=0x7e0,
+                        help='Number of the mcustomen CSR (default 0x7e0).')
+    parser.add_argument('--width', type=int, default=32,
+                        help='Width of the mcustomen CSR (default 32).')
+    parser.add_argument('--mode', choices=('group', 'single', 'subsets'),
+                        default='group',
+                        help='Candidate sets of instructions (default group).')
+    parser.add_argument('--max-ops', type=int, default=2,
+                        help='Largest subset size in subsets mode (default 2).')
+    parser.add_argument('--max-runs', type=int, default=10000,
+                        help='Refuse to start more runs than this (default 10000).')
+    parser.add_argument('--baseline', nargs='+', default=[],
+                        help='Benchmarks built without custom instructions, '
+                        'one per benchmark, run with all custom instructions '
+                        'disabled as the baseline.')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                        help='Number of parallel whisper runs.')
+    parser.add_argument('--timeout', type=float, default=600,
+                        help='Time limit of a single run in seconds.')
+    parser.add_argument('--whisper-args', default='',
+                        help='Extra whisper arguments (space separated).')
+    parser.add_argument('--csv', help='Write all the results to this file.')
+    args = parser.parse_args()
+    args.whisper_args = args.whisper_args.split()
+
+    ops = read_custom_ops(args.defs)
+    if not ops:
+        sys.exit('No custom instruction in %s' % args.defs)
+    if len(ops) > args.width:
+        sys.exit('More custom instructions than bits in mcustomen')
+
+    base_config = {}
+    if args.config:
+        with open(args.config) as f:
+            base_config = json.load(f)
+
+    if args.baseline and len(args.baseline) != len(args.benchmarks):
+        sys.exit('Need one --baseline file per benchmark')
+
+    if args.mode == 'group':
+        masks = group_masks(ops)
+    elif args.mode == 'single':
+        masks = [1 << i for i in range(len(ops))]
+    else:
+        max_size = min(max(args.max_ops, 1), len(ops))
+        count = subset_count(len(ops), max_size) * len(args.benchmarks)
+        if count > args.max_runs:
+            sys.exit('%d runs needed: Lower --max-ops or raise --max-runs' % count)
+        masks = [m for m in subsets(len(ops), max_size) if m]
+
+    # Baseline runs: Benchmarks (or their --baseline builds) with all
+    # custom instructions disabled.
+    baselines = args.baseline or args.benchmarks
+    jobs = [(0, bench) for bench in baselines]
+    jobs += [(mask, bench) for mask in masks for bench in args.benchmarks]
+    if len(jobs) > args.max_runs:
+        sys.exit('%d runs needed: Raise --max-runs' % len(jobs))
+
+    results = {}  # (mask, benchmark) -> retired count or None
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = [pool.submit(run_whisper, args, base_config, mask, bench)
+                   for mask, bench in jobs]
+        done = 0
+        for future in concurrent.futures.as_completed(futures):
+            mask, bench, retired = future.result()
+            results[(mask, bench)] = retired
+            done += 1
+            print('\r%d/%d runs' % (done, len(futures)), end='', file=sys.stderr)
+    print(file=sys.stderr)
+
+    if args.csv:
+        with open(args.csv, 'w') as f:
+            f.write('mask,ops,benchmark,retired\n')
+            for mask, bench in jobs:
+                retired = results[(mask, bench)]
+                f.write('%s,%s,%s,%s\n' % (hex(mask), mask_names(mask, ops), bench,
+                                           '' if retired is None else retired))
+
+    base = [results[(0, bench)] for bench in baselines]
+    if None in base:
+        failed = [b for b, r in zip(baselines, base) if r is None]
+        sys.exit('Baseline run (all custom instructions disabled) failed for %s: '
+                 'Use --baseline with builds not using custom instructions'
+                 % ', '.join(failed))
+    base_total = sum(base)
+
+    ranking = []
+    for mask in masks:
+        counts = [results[(mask, bench)] for bench in args.benchmarks]
+        if None in counts:
+            ranking.append((None, 0, mask))
+            continue
+        saved = base_total - sum(counts)
+        size = bin(mask).count('1')
+        ranking.append((saved / size, saved, mask))
+
+    ranking.sort(key=lambda r: (r[0] is not None, r[0] or 0), reverse=True)
+
+    print('%-12s %-14s %s' % ('saved/op', 'saved', 'ops'))
+    for per_op, saved, mask in ranking:
+        if per_op is None:
+            print('%-12s %-14s %s' % ('failed', '', mask_names(mask, ops)))
+        else:
+            print('%-12.1f %-14d %s' % (per_op, saved, mask_names(mask, ops)))
+
+
+if __name__ == '__main__':
+    main()
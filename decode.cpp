@@ -652,6 +652,40 @@ Hart<URV>::decodeVecStore(uint32_t f3, uint32_t imm12, uint32_t& op3)
 }
 
 
+/// Return the id of the custom instruction (see CustomInsts.def) with
+/// the given opcode (low 7 bits), funct7, funct3 and rs2 fields. Return
+/// InstId::illegal if there is no such instruction or if the rs2 field
+/// is not valid for the instruction form (must be zero in R2 form).
+static
+InstId
+customInstId(unsigned opcode, unsigned funct7, unsigned funct3, unsigned rs2)
+{
+#define CUSTOM_RS2_OK_R3(rs2)   true
+#define CUSTOM_RS2_OK_R2(rs2)   ((rs2) == 0)
+#define CUSTOM_RS2_OK_R3D(rs2)  true
+#define CUSTOM_RS2_OK_LDW(rs2)  true
+#define CUSTOM_RS2_OK_STW(rs2)  true
+#define CUSTOM_RS2_OK_LDM(rs2)  true
+#define CUSTOM_RS2_OK_STM(rs2)  true
+
+#define CUSTOM_INST(id, Name, mnemonic, op, f7, f3, form, expr)  \
+  if (opcode == (op) and funct7 == (f7) and funct3 == (f3))      \
+    return CUSTOM_RS2_OK_##form(rs2) ? InstId::id : InstId::illegal;
+#include "CustomInsts.def"
+#undef CUSTOM_INST
+
+#undef CUSTOM_RS2_OK_R3
+#undef CUSTOM_RS2_OK_R2
+#undef CUSTOM_RS2_OK_R3D
+#undef CUSTOM_RS2_OK_LDW
+#undef CUSTOM_RS2_OK_STW
+#undef CUSTOM_RS2_OK_LDM
+#undef CUSTOM_RS2_OK_STM
+
+  return InstId::illegal;
+}
+
+
 template <typename URV>
 const InstEntry&
 Hart<URV>::decode16(uint16_t inst, uint32_t& op0, uint32_t& op1, uint32_t& op2)
@@ -710,6 +744,15 @@ Hart<URV>::decode16(uint16_t inst, uint32_t& op0, uint32_t& op1, uint32_t& op2)
 	  return instTable_.getEntry(InstId::illegal);
 	}
 
+      if (funct3 == 4)  // Compressed custom: c.<op> rdp, rs2p
+	{
+	  CcustomFormInst ccf(inst);
+	  if (ccf.bits.funct2 != 0)
+	    return instTable_.getEntry(InstId::illegal);
+	  op0 = 8+ccf.bits.rdp; op1 = op0; op2 = 8+ccf.bits.rs2p;
+	  return instTable_.getEntry(customInstId(0x33, 2, ccf.bits.cfunct3, op2));
+	}
+
       if (funct3 == 5)  // c.fsd
 	{
 	  CsFormInst cs(inst);  // Double check this
@@ -744,7 +787,7 @@ Hart<URV>::decode16(uint16_t inst, uint32_t& op0, uint32_t& op1, uint32_t& op2)
 	  return instTable_.getEntry(InstId::c_sd);
 	}
 
-      // funct3 is 1 (c.fld c.lq), or 4 (reserved), or 5 (c.fsd c.sq)
+      // funct3 is 1 (c.fld c.lq), or 5 (c.fsd c.sq)
       return instTable_.getEntry(InstId::illegal);
     }
 
@@ -1054,6 +1097,20 @@ Hart<URV>::expandCompressedInst(uint16_t inst) const
 	  return expanded; // Illegal
 	}
 
+      if (funct3 == 4)  // Compressed custom: c.<op> rdp, rs2p
+	{
+	  CcustomFormInst ccf(inst);
+	  if (ccf.bits.funct2 != 0)
+	    return expanded; // Illegal
+	  if (customInstId(0x33, 2, ccf.bits.cfunct3, 8+ccf.bits.rs2p) == InstId::illegal)
+	    return expanded; // Illegal
+	  op0 = 8+ccf.bits.rdp; op2 = 8+ccf.bits.rs2p;
+	  RFormInst rf(0);
+	  rf.encodeCustom(0x33, 2, ccf.bits.cfunct3, op0, op0, op2);
+	  expanded = rf.code;
+	  return expanded;
+	}
+
       if (funct3 == 5)  // c.fsd
 	{
 	  CsFormInst cs(inst);  // Double check this
@@ -1092,7 +1149,7 @@ Hart<URV>::expandCompressedInst(uint16_t inst) const
           return expanded;
 	}
 
-      // funct3 is 1 (c.fld c.lq), or 4 (reserved), or 5 (c.fsd c.sq)
+      // funct3 is 1 (c.fld c.lq), or 5 (c.fsd c.sq)
       return expanded; // Illegal
     }
 
@@ -1553,11 +1610,29 @@ Hart<URV>::decode(uint32_t inst, uint32_t& op0, uint32_t& op1, uint32_t& op2,
     l21: // 10101
       return decodeVec(inst, op0, op1, op2, op3);
 
-    l22:
+    l22:  // 10110  custom-2
+    l30:  // 11110  custom-3
+      {
+	RFormInst rform(inst);
+	op0 = rform.bits.rd;
+	op1 = rform.bits.rs1;
+	op2 = rform.bits.rs2;
+	unsigned funct7 = rform.bits.funct7, funct3 = rform.bits.funct3;
+        if ((inst & 0x7f) == 0x7b and funct3 == 4)
+          {
+            // lp.setup L, rs1, uimm: I-form with loop index in rd.
+            IFormInst iform(inst);
+            op2 = iform.uimmed();
+            if (op0 > 1)
+              return instTable_.getEntry(InstId::illegal);
+            return instTable_.getEntry(InstId::lp_setup);
+          }
+	return instTable_.getEntry(customInstId(inst & 0x7f, funct7, funct3, op2));
+      }
+
     l23:
     l26:
     l29:
-    l30:
     l31:
       return instTable_.getEntry(InstId::illegal);
 
@@ -1832,20 +1907,8 @@ Hart<URV>::decode(uint32_t inst, uint32_t& op0, uint32_t& op1, uint32_t& op2,
 	    if (funct3 == 6) return instTable_.getEntry(InstId::rem);
 	    if (funct3 == 7) return instTable_.getEntry(InstId::remu);
 	  }
-/* INSERT YOUR CODE FROM HERE */  
-  else if(funct7 == 2)
-    {
-      // cube
-      if (funct3 == 0) return instTable_.getEntry(InstId::cube);
-      if (funct3 == 1) return instTable_.getEntry(InstId::rotleft);
-      if (funct3 == 2) return instTable_.getEntry(InstId::rotright);
-      if (funct3 == 3) return instTable_.getEntry(InstId::reverse);
-      if (funct3 == 4) return instTable_.getEntry(InstId::notand);
-      if (funct3 == 5) return instTable_.getEntry(InstId::extend1);
-      if (funct3 == 6) return instTable_.getEntry(InstId::extend2);
-      if (funct3 == 7) return instTable_.getEntry(InstId::extend3);
-    }
-/* INSERT YOUR CODE END HERE */
+	else if (funct7 == 2)
+	  return instTable_.getEntry(customInstId(0x33, funct7, funct3, op2));
 	else if (funct7 == 4)
 	  {
             if (funct3 == 1) return instTable_.getEntry(InstId::shfl);
@@ -0,0 +1,376 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmark of non-cryptographic hashes (xxHash32, MurmurHash3_x86_32
+// and FNV-1a 32) with and without the custom hash instructions of
+// CustomInsts.def (murmurk, murmurh, xxround, xsmul13/15/16, fnv1a).
+//
+// Build (baseline and custom variants) and run under whisper:
+//
+//   CC="riscv32-unknown-elf-gcc -O2 -march=rv32imac -mabi=ilp32"
+//   $CC -o hashbench hashbench.c
+//   $CC -DUSE_CUSTOM -o hashbench_custom hashbench.c
+//   whisper --newlib hashbench
+//   whisper --newlib hashbench_custom
+//
+// Each hash is first checked against known test vectors. Then it is
+// run over a set of short keys (hash-table workload) and over a long
+// buffer. The retired instruction counts (instret CSR) are reported
+// per hash and per byte. The program also builds on the host (without
+// USE_CUSTOM) to check the reference results; instruction counts are
+// then reported as zero.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#if defined(__riscv) && defined(USE_CUSTOM)
+
+// Custom instructions: custom-2 opcode (0x5b), funct7 0.
+
+static inline uint32_t murmurk(uint32_t k)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 0, 0, %0, %1, x0" : "=r"(r) : "r"(k));
+  return r;
+}
+
+static inline uint32_t murmurh(uint32_t h, uint32_t k)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 1, 0, %0, %1, %2" : "=r"(r) : "r"(h), "r"(k));
+  return r;
+}
+
+static inline uint32_t xxround(uint32_t acc, uint32_t input)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 2, 0, %0, %1, %2" : "=r"(r) : "r"(acc), "r"(input));
+  return r;
+}
+
+static inline uint32_t xsmul13(uint32_t x, uint32_t c)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 3, 0, %0, %1, %2" : "=r"(r) : "r"(x), "r"(c));
+  return r;
+}
+
+static inline uint32_t xsmul15(uint32_t x, uint32_t c)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 4, 0, %0, %1, %2" : "=r"(r) : "r"(x), "r"(c));
+  return r;
+}
+
+static inline uint32_t xsmul16(uint32_t x, uint32_t c)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 5, 0, %0, %1, %2" : "=r"(r) : "r"(x), "r"(c));
+  return r;
+}
+
+static inline uint32_t fnv1a(uint32_t h, uint32_t byte)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 6, 0, %0, %1, %2" : "=r"(r) : "r"(h), "r"(byte));
+  return r;
+}
+
+#else
+
+// Plain C equivalents of the custom instructions.
+
+static inline uint32_t rotl32(uint32_t x, unsigned n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t murmurk(uint32_t k)
+{
+  return rotl32(k * 0xcc9e2d51u, 15) * 0x1b873593u;
+}
+
+static inline uint32_t murmurh(uint32_t h, uint32_t k)
+{
+  return rotl32(h ^ k, 13) * 5u + 0xe6546b64u;
+}
+
+static inline uint32_t xxround(uint32_t acc, uint32_t input)
+{
+  return rotl32(acc + input * 0x85ebca77u, 13) * 0x9e3779b1u;
+}
+
+static inline uint32_t xsmul13(uint32_t x, uint32_t c)
+{
+  return (x ^ (x >> 13)) * c;
+}
+
+static inline uint32_t xsmul15(uint32_t x, uint32_t c)
+{
+  return (x ^ (x >> 15)) * c;
+}
+
+static inline uint32_t xsmul16(uint32_t x, uint32_t c)
+{
+  return (x ^ (x >> 16)) * c;
+}
+
+static inline uint32_t fnv1a(uint32_t h, uint32_t byte)
+{
+  return (h ^ (byte & 0xff)) * 0x01000193u;
+}
+
+#endif
+
+
+static inline uint32_t rotl(uint32_t x, unsigned n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+
+static inline uint32_t read32(const uint8_t* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+    ((uint32_t)p[3] << 24);
+}
+
+
+static inline uint64_t instret(void)
+{
+#if defined(__riscv)
+#if __riscv_xlen == 32
+  uint32_t lo, hi, hi2;
+  do
+    {
+      __asm__ volatile ("rdinstreth %0" : "=r"(hi));
+      __asm__ volatile ("rdinstret %0" : "=r"(lo));
+      __asm__ volatile ("rdinstreth %0" : "=r"(hi2));
+    }
+  while (hi != hi2);
+  return ((uint64_t)hi << 32) | lo;
+#else
+  uint64_t count;
+  __asm__ volatile ("rdinstret %0" : "=r"(count));
+  return count;
+#endif
+#else
+  return 0;
+#endif
+}
+
+
+#define PRIME32_1 0x9e3779b1u
+#define PRIME32_2 0x85ebca77u
+#define PRIME32_3 0xc2b2ae3du
+#define PRIME32_4 0x27d4eb2fu
+#define PRIME32_5 0x165667b1u
+
+
+uint32_t xxh32(const void* data, size_t len, uint32_t seed)
+{
+  const uint8_t* p = (const uint8_t*) data;
+  const uint8_t* end = p + len;
+  uint32_t h;
+
+  if (len >= 16)
+    {
+      const uint8_t* limit = end - 16;
+      uint32_t v1 = seed + PRIME32_1 + PRIME32_2;
+      uint32_t v2 = seed + PRIME32_2;
+      uint32_t v3 = seed;
+      uint32_t v4 = seed - PRIME32_1;
+      do
+        {
+          v1 = xxround(v1, read32(p));
+          v2 = xxround(v2, read32(p + 4));
+          v3 = xxround(v3, read32(p + 8));
+          v4 = xxround(v4, read32(p + 12));
+          p += 16;
+        }
+      while (p <= limit);
+      h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    }
+  else
+    h = seed + PRIME32_5;
+
+  h += (uint32_t) len;
+
+  while (p + 4 <= end)
+    {
+      h = rotl(h + read32(p) * PRIME32_3, 17) * PRIME32_4;
+      p += 4;
+    }
+  while (p < end)
+    {
+      h = rotl(h + (*p) * PRIME32_5, 11) * PRIME32_1;
+      p++;
+    }
+
+  h = xsmul15(h, PRIME32_2);
+  h = xsmul13(h, PRIME32_3);
+  return h ^ (h >> 16);
+}
+
+
+uint32_t murmur3_32(const void* data, size_t len, uint32_t seed)
+{
+  const uint8_t* p = (const uint8_t*) data;
+  size_t blocks = len / 4;
+  uint32_t h = seed;
+
+  for (size_t i = 0; i < blocks; ++i, p += 4)
+    h = murmurh(h, murmurk(read32(p)));
+
+  uint32_t k = 0;
+  switch (len & 3)
+    {
+    case 3: k ^= (uint32_t)p[2] << 16;  // Fall through.
+    case 2: k ^= (uint32_t)p[1] << 8;   // Fall through.
+    case 1: k ^= p[0];
+      h ^= murmurk(k);
+    }
+
+  h ^= (uint32_t) len;
+  h = xsmul16(h, 0x85ebca6bu);
+  h = xsmul13(h, 0xc2b2ae35u);
+  return h ^ (h >> 16);
+}
+
+
+uint32_t fnv1a_32(const void* data, size_t len)
+{
+  const uint8_t* p = (const uint8_t*) data;
+  uint32_t h = 0x811c9dc5u;
+  for (size_t i = 0; i < len; ++i)
+    h = fnv1a(h, p[i]);
+  return h;
+}
+
+
+enum { XXH32, MURMUR3, FNV1A, HASH_COUNT };
+
+static const char* hashNames[HASH_COUNT] = { "xxh32", "murmur3", "fnv1a" };
+
+
+static uint32_t hash(int kind, const void* data, size_t len)
+{
+  switch (kind)
+    {
+    case XXH32:   return xxh32(data, len, 0);
+    case MURMUR3: return murmur3_32(data, len, 0);
+    default:      return fnv1a_32(data, len);
+    }
+}
+
+
+struct TestVector
+{
+  int kind;
+  const char* text;
+  uint32_t seed;
+  uint32_t expected;
+};
+
+
+static const struct TestVector vectors[] = {
+  { XXH32,   "", 0, 0x02cc5d05u },
+  { XXH32,   "abc", 0, 0x32d153ffu },
+  { XXH32,   "Nobody inspects the spammish repetition", 0, 0xe2293b2fu },
+  { MURMUR3, "", 0, 0x00000000u },
+  { MURMUR3, "", 1, 0x514e28b7u },
+  { MURMUR3, "The quick brown fox jumps over the lazy dog", 0, 0x2e4ff723u },
+  { FNV1A,   "", 0, 0x811c9dc5u },
+  { FNV1A,   "a", 0, 0xe40c292cu },
+  { FNV1A,   "foobar", 0, 0xbf9cf968u },
+};
+
+
+static int check(void)
+{
+  int errors = 0;
+  for (size_t i = 0; i < sizeof(vectors)/sizeof(vectors[0]); ++i)
+    {
+      const struct TestVector* tv = &vectors[i];
+      size_t len = strlen(tv->text);
+      uint32_t h = 0;
+      if (tv->kind == XXH32)
+        h = xxh32(tv->text, len, tv->seed);
+      else if (tv->kind == MURMUR3)
+        h = murmur3_32(tv->text, len, tv->seed);
+      else
+        h = fnv1a_32(tv->text, len);
+      if (h != tv->expected)
+        {
+          printf("FAIL %s(\"%s\", %u) = 0x%08x expecting 0x%08x\n",
+                 hashNames[tv->kind], tv->text, (unsigned) tv->seed,
+                 (unsigned) h, (unsigned) tv->expected);
+          errors++;
+        }
+    }
+  return errors;
+}
+
+
+#define KEY_COUNT 1024
+#define KEY_SIZE  16
+#define BUF_SIZE  4096
+
+static uint8_t keys[KEY_COUNT][KEY_SIZE];
+static uint8_t buffer[BUF_SIZE];
+
+
+int main(void)
+{
+  if (check())
+    return 1;
+
+  // Deterministic pseudo-random input.
+  uint32_t x = 12345;
+  for (size_t i = 0; i < KEY_COUNT; ++i)
+    for (size_t j = 0; j < KEY_SIZE; ++j)
+      keys[i][j] = (uint8_t) ((x = x * 1103515245u + 12345u) >> 16);
+  for (size_t i = 0; i < BUF_SIZE; ++i)
+    buffer[i] = (uint8_t) ((x = x * 1103515245u + 12345u) >> 16);
+
+#if defined(USE_CUSTOM)
+  printf("hashbench (custom instructions)\n");
+#else
+  printf("hashbench (baseline)\n");
+#endif
+  printf("%-8s %-10s %12s %10s %12s %10s\n", "hash", "checksum", "keys-insts",
+         "insts/key", "buf-insts", "insts/byte");
+
+  for (int kind = 0; kind < HASH_COUNT; ++kind)
+    {
+      uint32_t sum = 0;
+
+      uint64_t t0 = instret();
+      for (size_t i = 0; i < KEY_COUNT; ++i)
+        sum += hash(kind, keys[i], KEY_SIZE);
+      uint64_t t1 = instret();
+      sum += hash(kind, buffer, BUF_SIZE);
+      uint64_t t2 = instret();
+
+      unsigned long keyInsts = (unsigned long) (t1 - t0);
+      unsigned long bufInsts = (unsigned long) (t2 - t1);
+      printf("%-8s 0x%08x %12lu %10lu %12lu %10.2f\n", hashNames[kind],
+             (unsigned) sum, keyInsts, keyInsts / KEY_COUNT, bufInsts,
+             (double) bufInsts / BUF_SIZE);
+    }
+
+  return 0;
+}
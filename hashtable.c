@@ -0,0 +1,600 @@
+// Copyright 2020 Western Digital Corporation or its affiliates.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Hash-table benchmark: An open-addressing (linear probing) table with
+// string keys is filled and then looked up using a selectable hash:
+//
+//   sha256  -- First 4 bytes of the SHA-256 digest computed with the
+//              sha256_init/update/final routines of sha256opt.s.
+//   xxh32   -- xxHash32 (using the xxround/xsmul custom instructions
+//              of CustomInsts.def with USE_CUSTOM).
+//   fnv1a   -- FNV-1a 32 (using the fnv1a custom instruction with
+//              USE_CUSTOM).
+//
+// Build, linking in the SHA-256 routines of sha256opt.s (its main is
+// made weak so that the one here is used), and run under whisper:
+//
+//   CC="riscv32-unknown-elf-gcc -O2 -march=rv32imac -mabi=ilp32"
+//   $CC -c sha256opt.s && riscv32-unknown-elf-objcopy -W main sha256opt.o
+//   $CC -DUSE_SHA256OPT -DUSE_CUSTOM -o hashtable hashtable.c sha256opt.o
+//   whisper --newlib --target "hashtable xxh32 2000 8000 90 8 24"
+//
+// Arguments (all optional): hash keys lookups hit-percent min-key-length
+// max-key-length. The key stream is deterministic: The given number of
+// keys is inserted, then the given number of lookups is made with
+// hit-percent percent of them looking for an inserted key.
+//
+// Dynamic instructions (instret CSR) and cycles (mcycle CSR) are
+// reported per operation broken down into hashing (computing the hash
+// of the key), probing (walking the table comparing stored hashes and
+// keys) and memory (copying the key into the table or reading the
+// value out). The cost of reading the counters is measured once and
+// subtracted. hashtable_bench.py runs all the hashes and tabulates the
+// results. The program also builds on the host (counts are then zero)
+// using a C SHA-256 with the same interface.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Same layout as the context used by sha256opt.s.
+typedef struct
+{
+  uint8_t data[64];
+  uint32_t datalen;
+  uint64_t bitlen;
+  uint32_t state[8];
+} SHA256_CTX;
+
+void sha256_init(SHA256_CTX* ctx);
+void sha256_update(SHA256_CTX* ctx, const uint8_t* data, size_t len);
+void sha256_final(SHA256_CTX* ctx, uint8_t hash[32]);
+
+
+#if defined(__riscv) && defined(USE_CUSTOM)
+
+static inline uint32_t xxround(uint32_t acc, uint32_t input)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 2, 0, %0, %1, %2" : "=r"(r) : "r"(acc), "r"(input));
+  return r;
+}
+
+static inline uint32_t xsmul13(uint32_t x, uint32_t c)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 3, 0, %0, %1, %2" : "=r"(r) : "r"(x), "r"(c));
+  return r;
+}
+
+static inline uint32_t xsmul15(uint32_t x, uint32_t c)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 4, 0, %0, %1, %2" : "=r"(r) : "r"(x), "r"(c));
+  return r;
+}
+
+static inline uint32_t fnv1a(uint32_t h, uint32_t byte)
+{
+  uint32_t r;
+  __asm__ (".insn r 0x5b, 6, 0, %0, %1, %2" : "=r"(r) : "r"(h), "r"(byte));
+  return r;
+}
+
+#else
+
+static inline uint32_t rotl32(uint32_t x, unsigned n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t xxround(uint32_t acc, uint32_t input)
+{
+  return rotl32(acc + input * 0x85ebca77u, 13) * 0x9e3779b1u;
+}
+
+static inline uint32_t xsmul13(uint32_t x, uint32_t c)
+{
+  return (x ^ (x >> 13)) * c;
+}
+
+static inline uint32_t xsmul15(uint32_t x, uint32_t c)
+{
+  return (x ^ (x >> 15)) * c;
+}
+
+static inline uint32_t fnv1a(uint32_t h, uint32_t byte)
+{
+  return (h ^ (byte & 0xff)) * 0x01000193u;
+}
+
+#endif
+
+
+#if defined(__riscv)
+
+#if __riscv_xlen == 32
+#define READ_COUNTER(name, var)                                   \
+  do                                                              \
+    {                                                             \
+      uint32_t lo_, hi_, hi2_;                                    \
+      do                                                          \
+        {                                                         \
+          __asm__ volatile ("rd" name "h %0" : "=r"(hi_));        \
+          __asm__ volatile ("rd" name " %0" : "=r"(lo_));         \
+          __asm__ volatile ("rd" name "h %0" : "=r"(hi2_));       \
+        }                                                         \
+      while (hi_ != hi2_);                                        \
+      var = ((uint64_t)hi_ << 32) | lo_;                          \
+    }                                                             \
+  while (0)
+#else
+#define READ_COUNTER(name, var)                                   \
+  __asm__ volatile ("rd" name " %0" : "=r"(var))
+#endif
+
+#else
+
+#define READ_COUNTER(name, var)  (var = 0)
+
+#endif
+
+
+/// Counter sample: retired instructions and cycles.
+typedef struct
+{
+  uint64_t insts;
+  uint64_t cycles;
+} Sample;
+
+
+static inline void sample(Sample* s)
+{
+  READ_COUNTER("instret", s->insts);
+  READ_COUNTER("cycle", s->cycles);
+}
+
+
+static inline uint32_t read32(const uint8_t* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+    ((uint32_t)p[3] << 24);
+}
+
+
+#if !defined(USE_SHA256OPT)
+
+// C SHA-256 with the interface of sha256opt.s (used when sha256opt.o
+// is not linked in, e.g. on the host).
+
+static const uint32_t k256[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+static inline uint32_t rotr(uint32_t x, unsigned n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+
+static void sha256_transform(SHA256_CTX* ctx, const uint8_t* data)
+{
+  uint32_t m[64];
+  for (unsigned i = 0; i < 16; ++i)
+    m[i] = ((uint32_t)data[4*i] << 24) | ((uint32_t)data[4*i+1] << 16) |
+      ((uint32_t)data[4*i+2] << 8) | data[4*i+3];
+  for (unsigned i = 16; i < 64; ++i)
+    {
+      uint32_t s0 = rotr(m[i-15], 7) ^ rotr(m[i-15], 18) ^ (m[i-15] >> 3);
+      uint32_t s1 = rotr(m[i-2], 17) ^ rotr(m[i-2], 19) ^ (m[i-2] >> 10);
+      m[i] = m[i-16] + s0 + m[i-7] + s1;
+    }
+
+  uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2];
+  uint32_t d = ctx->state[3], e = ctx->state[4], f = ctx->state[5];
+  uint32_t g = ctx->state[6], h = ctx->state[7];
+
+  for (unsigned i = 0; i < 64; ++i)
+    {
+      uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+        ((e & f) ^ (~e & g)) + k256[i] + m[i];
+      uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+        ((a & b) ^ (a & c) ^ (b & c));
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+
+  ctx->state[0] += a; ctx->state[1] += b; ctx->state[2] += c;
+  ctx->state[3] += d; ctx->state[4] += e; ctx->state[5] += f;
+  ctx->state[6] += g; ctx->state[7] += h;
+}
+
+
+void sha256_init(SHA256_CTX* ctx)
+{
+  static const uint32_t iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+  ctx->datalen = 0;
+  ctx->bitlen = 0;
+  memcpy(ctx->state, iv, sizeof(iv));
+}
+
+
+void sha256_update(SHA256_CTX* ctx, const uint8_t* data, size_t len)
+{
+  for (size_t i = 0; i < len; ++i)
+    {
+      ctx->data[ctx->datalen++] = data[i];
+      if (ctx->datalen == 64)
+        {
+          sha256_transform(ctx, ctx->data);
+          ctx->bitlen += 512;
+          ctx->datalen = 0;
+        }
+    }
+}
+
+
+void sha256_final(SHA256_CTX* ctx, uint8_t hash[32])
+{
+  uint32_t i = ctx->datalen;
+  ctx->data[i++] = 0x80;
+  if (ctx->datalen >= 56)
+    {
+      while (i < 64)
+        ctx->data[i++] = 0;
+      sha256_transform(ctx, ctx->data);
+      i = 0;
+    }
+  while (i < 56)
+    ctx->data[i++] = 0;
+
+  ctx->bitlen += ctx->datalen * 8;
+  for (unsigned j = 0; j < 8; ++j)
+    ctx->data[63 - j] = (uint8_t) (ctx->bitlen >> (8*j));
+  sha256_transform(ctx, ctx->data);
+
+  for (unsigned j = 0; j < 32; ++j)
+    hash[j] = (uint8_t) (ctx->state[j / 4] >> (24 - 8*(j % 4)));
+}
+
+#endif
+
+
+static uint32_t sha256_32(const uint8_t* key, size_t len)
+{
+  SHA256_CTX ctx;
+  uint8_t digest[32];
+  sha256_init(&ctx);
+  sha256_update(&ctx, key, len);
+  sha256_final(&ctx, digest);
+  return read32(digest);
+}
+
+
+static uint32_t xxh32(const uint8_t* p, size_t len)
+{
+  const uint8_t* end = p + len;
+  uint32_t h;
+
+  if (len >= 16)
+    {
+      const uint8_t* limit = end - 16;
+      uint32_t v1 = 0x9e3779b1u + 0x85ebca77u, v2 = 0x85ebca77u;
+      uint32_t v3 = 0, v4 = -0x9e3779b1u;
+      do
+        {
+          v1 = xxround(v1, read32(p));
+          v2 = xxround(v2, read32(p + 4));
+          v3 = xxround(v3, read32(p + 8));
+          v4 = xxround(v4, read32(p + 12));
+          p += 16;
+        }
+      while (p <= limit);
+      h = ((v1 << 1) | (v1 >> 31)) + ((v2 << 7) | (v2 >> 25)) +
+        ((v3 << 12) | (v3 >> 20)) + ((v4 << 18) | (v4 >> 14));
+    }
+  else
+    h = 0x165667b1u;
+
+  h += (uint32_t) len;
+  for (; p + 4 <= end; p += 4)
+    {
+      h += read32(p) * 0xc2b2ae3du;
+      h = ((h << 17) | (h >> 15)) * 0x27d4eb2fu;
+    }
+  for (; p < end; ++p)
+    {
+      h += (*p) * 0x165667b1u;
+      h = ((h << 11) | (h >> 21)) * 0x9e3779b1u;
+    }
+
+  h = xsmul15(h, 0x85ebca77u);
+  h = xsmul13(h, 0xc2b2ae3du);
+  return h ^ (h >> 16);
+}
+
+
+static uint32_t fnv1a_32(const uint8_t* p, size_t len)
+{
+  uint32_t h = 0x811c9dc5u;
+  for (size_t i = 0; i < len; ++i)
+    h = fnv1a(h, p[i]);
+  return h;
+}
+
+
+typedef uint32_t (*HashFunc)(const uint8_t*, size_t);
+
+struct Hash
+{
+  const char* name;
+  HashFunc func;
+};
+
+static const struct Hash hashes[] = {
+  { "sha256", sha256_32 },
+  { "xxh32",  xxh32 },
+  { "fnv1a",  fnv1a_32 },
+};
+
+
+#define MAX_KEY_LEN 64
+
+/// Table slot: A zero length marks an empty slot.
+typedef struct
+{
+  uint32_t hash;
+  uint32_t len;
+  uint32_t value;
+  uint8_t key[MAX_KEY_LEN];
+} Slot;
+
+
+/// Per-phase counter totals.
+typedef struct
+{
+  Sample hash, probe, mem;
+  unsigned ops;
+  unsigned probes;
+} Phases;
+
+
+static Slot* table;
+static uint32_t tableMask;
+static uint64_t sampleInstCost, sampleCycleCost;
+
+
+static inline void accumulate(Sample* total, const Sample* a, const Sample* b)
+{
+  total->insts += b->insts - a->insts - sampleInstCost;
+  total->cycles += b->cycles - a->cycles - sampleCycleCost;
+}
+
+
+/// Insert given key/value. Return 1 if inserted, 0 if key was already
+/// present or table is full.
+static int insert(HashFunc func, const uint8_t* key, uint32_t len,
+                  uint32_t value, Phases* ph)
+{
+  Sample s0, s1, s2, s3;
+
+  sample(&s0);
+  uint32_t h = func(key, len);
+  sample(&s1);
+
+  uint32_t ix = h & tableMask;
+  Slot* slot = NULL;
+  for (uint32_t n = 0; n <= tableMask; ++n, ix = (ix + 1) & tableMask)
+    {
+      ph->probes++;
+      Slot* s = &table[ix];
+      if (s->len == 0)
+        {
+          slot = s;
+          break;
+        }
+      if (s->hash == h && s->len == len && memcmp(s->key, key, len) == 0)
+        break;
+    }
+  sample(&s2);
+
+  if (slot)
+    {
+      slot->hash = h;
+      slot->len = len;
+      slot->value = value;
+      memcpy(slot->key, key, len);
+    }
+  sample(&s3);
+
+  accumulate(&ph->hash, &s0, &s1);
+  accumulate(&ph->probe, &s1, &s2);
+  accumulate(&ph->mem, &s2, &s3);
+  ph->ops++;
+  return slot != NULL;
+}
+
+
+/// Look up given key. Return 1 and set value if found.
+static int lookup(HashFunc func, const uint8_t* key, uint32_t len,
+                  uint32_t* value, Phases* ph)
+{
+  Sample s0, s1, s2, s3;
+
+  sample(&s0);
+  uint32_t h = func(key, len);
+  sample(&s1);
+
+  uint32_t ix = h & tableMask;
+  const Slot* found = NULL;
+  for (uint32_t n = 0; n <= tableMask; ++n, ix = (ix + 1) & tableMask)
+    {
+      ph->probes++;
+      const Slot* s = &table[ix];
+      if (s->len == 0)
+        break;
+      if (s->hash == h && s->len == len && memcmp(s->key, key, len) == 0)
+        {
+          found = s;
+          break;
+        }
+    }
+  sample(&s2);
+
+  if (found)
+    *value = found->value;
+  sample(&s3);
+
+  accumulate(&ph->hash, &s0, &s1);
+  accumulate(&ph->probe, &s1, &s2);
+  accumulate(&ph->mem, &s2, &s3);
+  ph->ops++;
+  return found != NULL;
+}
+
+
+static uint32_t rng;
+
+static inline uint32_t nextRandom(void)
+{
+  rng = rng * 1103515245u + 12345u;
+  return rng >> 8;
+}
+
+
+/// Generate key number n (deterministic) into buf. Return its length.
+static uint32_t makeKey(uint32_t n, uint8_t* buf, unsigned minLen, unsigned maxLen)
+{
+  uint32_t x = n * 2654435761u + 0x5bd1e995u;
+  unsigned len = minLen + x % (maxLen - minLen + 1);
+  int prefix = snprintf((char*) buf, MAX_KEY_LEN, "key%u:", (unsigned) n);
+  for (unsigned i = prefix; i < len; ++i)
+    {
+      x = x * 1103515245u + 12345u;
+      buf[i] = (uint8_t) ('a' + (x >> 16) % 26);
+    }
+  return len > (unsigned) prefix ? len : (unsigned) prefix;
+}
+
+
+static void report(const char* what, const Phases* ph)
+{
+  unsigned ops = ph->ops ? ph->ops : 1;
+  uint64_t insts = ph->hash.insts + ph->probe.insts + ph->mem.insts;
+  uint64_t cycles = ph->hash.cycles + ph->probe.cycles + ph->mem.cycles;
+  printf("%-7s ops %6u  probes/op %5.2f  insts/op %8.1f (hash %8.1f probe %6.1f"
+         " mem %6.1f)  cycles/op %8.1f (hash %8.1f probe %6.1f mem %6.1f)\n",
+         what, ph->ops, (double) ph->probes / ops, (double) insts / ops,
+         (double) ph->hash.insts / ops, (double) ph->probe.insts / ops,
+         (double) ph->mem.insts / ops, (double) cycles / ops,
+         (double) ph->hash.cycles / ops, (double) ph->probe.cycles / ops,
+         (double) ph->mem.cycles / ops);
+}
+
+
+int main(int argc, char* argv[])
+{
+  const char* hashName = argc > 1 ? argv[1] : "xxh32";
+  unsigned keys = argc > 2 ? (unsigned) atoi(argv[2]) : 1000;
+  unsigned lookups = argc > 3 ? (unsigned) atoi(argv[3]) : 4000;
+  unsigned hitPercent = argc > 4 ? (unsigned) atoi(argv[4]) : 90;
+  unsigned minLen = argc > 5 ? (unsigned) atoi(argv[5]) : 8;
+  unsigned maxLen = argc > 6 ? (unsigned) atoi(argv[6]) : 24;
+
+  const struct Hash* hash = NULL;
+  for (size_t i = 0; i < sizeof(hashes)/sizeof(hashes[0]); ++i)
+    if (strcmp(hashes[i].name, hashName) == 0)
+      hash = &hashes[i];
+  if (!hash)
+    {
+      printf("Unknown hash: %s (expecting sha256, xxh32 or fnv1a)\n", hashName);
+      return 1;
+    }
+  if (maxLen >= MAX_KEY_LEN)
+    maxLen = MAX_KEY_LEN - 1;
+  if (minLen > maxLen)
+    minLen = maxLen;
+
+  // Table size: Power of 2 with a load factor of at most 1/2.
+  uint32_t size = 16;
+  while (size < 2*keys)
+    size *= 2;
+  table = calloc(size, sizeof(Slot));
+  if (!table)
+    {
+      printf("Failed to allocate table of %u slots\n", (unsigned) size);
+      return 1;
+    }
+  tableMask = size - 1;
+
+  // Cost of taking a sample.
+  Sample c0, c1;
+  sample(&c0);
+  sample(&c1);
+  sampleInstCost = c1.insts - c0.insts;
+  sampleCycleCost = c1.cycles - c0.cycles;
+
+  printf("hashtable hash %s keys %u lookups %u hit %u%% key-length %u-%u slots %u\n",
+         hash->name, keys, lookups, hitPercent, minLen, maxLen, (unsigned) size);
+
+  uint8_t key[MAX_KEY_LEN];
+  Phases ins, look;
+  memset(&ins, 0, sizeof(ins));
+  memset(&look, 0, sizeof(look));
+
+  int errors = 0;
+  for (unsigned i = 0; i < keys; ++i)
+    {
+      uint32_t len = makeKey(i, key, minLen, maxLen);
+      if (!insert(hash->func, key, len, i, &ins))
+        errors++;
+    }
+
+  rng = 2020;
+  unsigned hits = 0;
+  for (unsigned i = 0; i < lookups; ++i)
+    {
+      int wantHit = nextRandom() % 100 < hitPercent;
+      uint32_t n = wantHit ? nextRandom() % keys : keys + nextRandom() % (1u << 20);
+      uint32_t len = makeKey(n, key, minLen, maxLen);
+      uint32_t value = 0;
+      int found = lookup(hash->func, key, len, &value, &look);
+      if (found != wantHit || (found && value != n))
+        errors++;
+      hits += found;
+    }
+
+  report("insert", &ins);
+  report("lookup", &look);
+  printf("hits %u  errors %d\n", hits, errors);
+
+  free(table);
+  return errors ? 1 : 0;
+}
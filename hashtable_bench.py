@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+
+# Copyright 2020 Western Digital Corporation or its affiliates.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Run the hashtable benchmark under whisper for each hash function.
+
+For each hash (and each key stream given on the command line) the
+benchmark is run and the dynamic instructions and cycles per insert
+and per lookup are tabulated, broken down into hashing, probing and
+memory. Cycles are taken from the mcycle CSR. When that does not
+advance (counters disabled), they are estimated from the instruction
+counts using the --cpi and --mem-cpi factors.
+
+Example:
+  hashtable_bench.py --whisper ./whisper hashtable \\
+      --stream 1000,4000,90,8,24 --stream 4000,16000,50,16,48
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+
+HASHES = ('sha256', 'xxh32', 'fnv1a')
+
+LINE = re.compile(r'^(insert|lookup)\s+ops\s+(\d+)\s+probes/op\s+([0-9.]+)\s+'
+                  r'insts/op\s+([0-9.]+)\s+\(hash\s+([0-9.]+)\s+probe\s+([0-9.]+)\s+'
+                  r'mem\s+([0-9.]+)\)\s+cycles/op\s+([0-9.]+)\s+\(hash\s+([0-9.]+)\s+'
+                  r'probe\s+([0-9.]+)\s+mem\s+([0-9.]+)\)', re.M)
+
+
+def run(whisper, extra, program, hash_name, stream):
+    """Run the benchmark. Return a dictionary mapping insert/lookup to
+    the list of numbers reported, or None on failure."""
+    target = ' '.join([program, hash_name] + stream.split(','))
+    cmd = [whisper] + extra + ['--target', target]
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                          universal_newlines=True)
+    if proc.returncode != 0:
+        return None
+    results = {}
+    for match in LINE.finditer(proc.stdout):
+        results[match.group(1)] = [float(x) for x in match.groups()[1:]]
+    return results if len(results) == 2 else None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('program', help='hashtable ELF file.')
+    parser.add_argument('--whisper', default='whisper',
+                        help='Path to the whisper executable.')
+    parser.add_argument('--whisper-args', default='--newlib',
+                        help='Whisper arguments (space separated).')
+    parser.add_argument('--hash', action='append', choices=HASHES,
+                        help='Hash to run (default: all).')
+    parser.add_argument('--stream', action='append',
+                        help='Key stream: keys,lookups,hit-percent,min-len,max-len'
+                        ' (default: 1000,4000,90,8,24).')
+    parser.add_argument('--cpi', type=float, default=1.0,
+                        help='Cycles per instruction for hashing/probing estimate.')
+    parser.add_argument('--mem-cpi', type=float, default=2.0,
+                        help='Cycles per instruction for memory phase estimate.')
+    args = parser.parse_args()
+
+    extra = args.whisper_args.split()
+    hashes = args.hash or HASHES
+    streams = args.stream or ['1000,4000,90,8,24']
+
+    header = ('%-8s %-22s %-6s %8s %9s %8s %8s %8s %10s' %
+              ('hash', 'stream', 'op', 'probes', 'insts', 'hash', 'probe', 'mem',
+               'cycles'))
+    print(header)
+    print('-' * len(header))
+
+    failed = 0
+    for stream in streams:
+        for hash_name in hashes:
+            results = run(args.whisper, extra, args.program, hash_name, stream)
+            if results is None:
+                print('%-8s %-22s run failed' % (hash_name, stream))
+                failed += 1
+                continue
+            for op in ('insert', 'lookup'):
+                (_, probes, insts, hash_insts, probe_insts, mem_insts,
+                 cycles, _, _, _) = results[op]
+                if cycles == 0:
+                    cycles = ((hash_insts + probe_insts) * args.cpi +
+                              mem_insts * args.mem_cpi)
+                print('%-8s %-22s %-6s %8.2f %9.1f %8.1f %8.1f %8.1f %10.1f' %
+                      (hash_name, stream, op, probes, insts, hash_insts,
+                       probe_insts, mem_insts, cycles))
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -17,122 +17,32 @@
 
 using namespace WdRiscv;
 
-/* BEGIN YOUR CODE FROM HERE */
 
 bool
-RFormInst::encodeCube(unsigned rdv, unsigned rs1v, unsigned rs2v)
+RFormInst::encodeCustom(unsigned opcode, unsigned funct7, unsigned funct3,
+                        unsigned rdv, unsigned rs1v, unsigned rs2v)
 {
   if (rdv > 31 or rs1v > 31 or rs2v > 31)
     return false;
-  bits.opcode = 0x33;
-  bits.rd = rdv & 0x1f;
-  bits.funct3 = 0;
-  bits.rs1 = rs1v & 0x1f;
-  bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
-  return true;
-}
-
-bool
-RFormInst::encodeRotleft(unsigned rdv, unsigned rs1v, unsigned rs2v)
-{
-  if (rdv > 31 or rs1v > 31 or rs2v > 31)
-    return false;
-  bits.opcode = 0x33;
-  bits.rd = rdv & 0x1f;
-  bits.funct3 = 1;
-  bits.rs1 = rs1v & 0x1f;
-  bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
-  return true;
-}
-
-bool
-RFormInst::encodeRotright(unsigned rdv, unsigned rs1v, unsigned rs2v)
-{
-  if (rdv > 31 or rs1v > 31 or rs2v > 31)
-    return false;
-  bits.opcode = 0x33;
-  bits.rd = rdv & 0x1f;
-  bits.funct3 = 2;
-  bits.rs1 = rs1v & 0x1f;
-  bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
-  return true;
-}
-
-
-bool
-RFormInst::encodeReverse(unsigned rdv, unsigned rs1v, unsigned rs2v)
-{
- if (rdv > 31 or rs1v > 31 or rs2v > 31)
-    return false;
-  bits.opcode = 0x33;
-  bits.rd = rdv & 0x1f;
-  bits.funct3 = 3;
-  bits.rs1 = rs1v & 0x1f;
-  bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
-  return true;
-}
-
-bool
-RFormInst::encodeNotand(unsigned rdv, unsigned rs1v, unsigned rs2v)
-{
-  if (rdv > 31 or rs1v > 31 or rs2v > 31)
-    return false;
-  bits.opcode = 0x33;
-  bits.rd = rdv & 0x1f;
-  bits.funct3 = 4;
-  bits.rs1 = rs1v & 0x1f;
-  bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
-  return true;
-}
-
-bool
-RFormInst::encodeExtend1(unsigned rdv, unsigned rs1v, unsigned rs2v)
-{
-  if (rdv > 31 or rs1v > 31 or rs2v > 31)
-    return false;
-  bits.opcode = 0x33;
+  bits.opcode = opcode;
   bits.rd = rdv & 0x1f;
-  bits.funct3 = 5;
+  bits.funct3 = funct3;
   bits.rs1 = rs1v & 0x1f;
   bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
+  bits.funct7 = funct7;
   return true;
 }
 
-bool
-RFormInst::encodeExtend2(unsigned rdv, unsigned rs1v, unsigned rs2v)
-{
-  if (rdv > 31 or rs1v > 31 or rs2v > 31)
-    return false;
-  bits.opcode = 0x33;
-  bits.rd = rdv & 0x1f;
-  bits.funct3 = 6;
-  bits.rs1 = rs1v & 0x1f;
-  bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
-  return true;
-}
 
-bool
-RFormInst::encodeExtend3(unsigned rdv, unsigned rs1v, unsigned rs2v)
-{
-  if (rdv > 31 or rs1v > 31 or rs2v > 31)
-    return false;
-  bits.opcode = 0x33;
-  bits.rd = rdv & 0x1f;
-  bits.funct3 = 7;
-  bits.rs1 = rs1v & 0x1f;
-  bits.rs2 = rs2v & 0x1f;
-  bits.funct7 = 2;
-  return true;
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+bool                                                                    \
+RFormInst::encode##Name(unsigned rdv, unsigned rs1v, unsigned rs2v)     \
+{                                                                       \
+  return encodeCustom(opcode, funct7, funct3, rdv, rs1v, rs2v);         \
 }
+#include "CustomInsts.def"
+#undef CUSTOM_INST
 
-/* YOUR CODE END HERE */
 
 bool
 RFormInst::encodeAdd(unsigned rdv, unsigned rs1v, unsigned rs2v)
@@ -1516,6 +1426,23 @@ CsFormInst::encodeCsd(unsigned rs1pv, unsigned rs2pv, unsigned imm)
 }
 
 
+bool
+CcustomFormInst::encodeCcustom(unsigned funct3, unsigned rdpv, unsigned rs2pv)
+{
+  if (funct3 > 7 or rdpv > 7 or rs2pv > 7)
+    return false;  // Field(s) out of bounds.
+
+  bits.opcode = 0;
+  bits.rs2p = rs2pv & 0x7;
+  bits.funct2 = 0;
+  bits.rdp = rdpv & 0x7;
+  bits.cfunct3 = funct3 & 0x7;
+  bits.funct3 = 4;
+  bits.unused = 0;
+  return true;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 bool
@@ -81,33 +81,18 @@ namespace WdRiscv
     /// Encode "and rd, rs1, rs2" into this object.
     bool encodeAnd(unsigned rd, unsigned rs1, unsigned rs2);
 
-/* INSERT YOUR CODE FROM HERE */
-
-    /// Encode "Cube rd, rs1, rs2" into this object.
-    bool encodeCube(unsigned rd, unsigned rs1, unsigned rs2);
-
-    /// Encode "Rotleft rd, rs1, rs2" into this object.
-    bool encodeRotleft(unsigned rd, unsigned rs1, unsigned rs2);
-
-    /// Encode "Rotright rd, rs1, rs2" into this object.
-    bool encodeRotright(unsigned rd, unsigned rs1, unsigned rs2);
-    
-    /// Encode "Reverse rd, rs1, rs2" into this object.
-    bool encodeReverse(unsigned rd, unsigned rs1, unsigned rs2);
-
-    /// Encode "Notand rd, rs1, rs2" into this object.
-    bool encodeNotand(unsigned rd, unsigned rs1, unsigned rs2);
-
-    
-    bool encodeExtend1(unsigned rd, unsigned rs1, unsigned rs2);
-    
-    
-    bool encodeExtend2(unsigned rd, unsigned rs1, unsigned rs2);
-    
-    
-    bool encodeExtend3(unsigned rd, unsigned rs1, unsigned rs2);
-    
-/* INSERT YOUR CODE END HERE */
+    /// Encode an R-form custom instruction with the given opcode,
+    /// funct7 and funct3 fields (see CustomInsts.def) into this
+    /// object. Pass zero for rs2 if the instruction has no rs2
+    /// operand.
+    bool encodeCustom(unsigned opcode, unsigned funct7, unsigned funct3,
+                      unsigned rd, unsigned rs1, unsigned rs2);
+
+    // Encoders of the individual custom instructions: encodeName(rd, rs1, rs2).
+#define CUSTOM_INST(id, Name, mnemonic, opcode, funct7, funct3, form, expr) \
+    bool encode##Name(unsigned rd, unsigned rs1, unsigned rs2);
+#include "CustomInsts.def"
+#undef CUSTOM_INST
 
     /// Encode "addw rd, rs1, rs2" into this object.
     bool encodeAddw(unsigned rd, unsigned rs1, unsigned rs2);
@@ -856,6 +841,36 @@ namespace WdRiscv
   };
 
 
+  /// Pack/unpack the compressed custom instructions: Quadrant 0 with
+  /// funct3 = 4 (reserved in the standard). The instruction
+  /// "c.<op> rdp, rs2p" expands to the 32-bit custom instruction
+  /// "<op> rd, rd, rs2" of opcode 0x33 and funct7 2 (see
+  /// CustomInsts.def) whose funct3 is in bits 12:10 (cfunct3). Bits
+  /// 6:5 (funct2) must be zero.
+  union CcustomFormInst
+  {
+    CcustomFormInst(uint16_t inst)
+    { code = inst; }
+
+    /// Encode "c.<op> rdpv, rs2pv" where op is the custom instruction
+    /// of opcode 0x33, funct7 2 and the given funct3.
+    bool encodeCcustom(unsigned funct3, unsigned rdpv, unsigned rs2pv);
+
+    uint32_t code;
+
+    struct
+    {
+      unsigned opcode  : 2;
+      unsigned rs2p    : 3;
+      unsigned funct2  : 2;
+      unsigned rdp     : 3;
+      unsigned cfunct3 : 3;
+      unsigned funct3  : 3;
+      unsigned unused  : 16;
+    } bits;
+  };
+
+
   // We make all encode functions have the same signature. Instruction
   // that do not require certain arguments are passed zero for those
   // arguments.
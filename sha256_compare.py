@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+
+# Copyright 2020 Western Digital Corporation or its affiliates.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Compare sha256opt (custom instructions) with sha256zbb (standard Zbb).
+
+sha256zbb.s is sha256opt.s with every custom instruction replaced by
+its standard equivalent: rotleft/rotright become rori, notand becomes
+andn, reverse becomes rev8 plus a shift and the extend2/extend3
+address and length computations become a shift and an add. The message
+schedule load also uses a word load and rev8 instead of four byte
+loads. Build with:
+
+  CC="riscv32-unknown-elf-gcc -march=rv32imac -mabi=ilp32"
+  $CC -o sha256opt sha256opt.s
+  $CC -o sha256zbb sha256zbb.s
+
+Both programs are run under whisper (which must have Zbb enabled, for
+example with an isa string containing zbb in the configuration file)
+on the same inputs. Their digests are checked against hashlib and the
+report lists, per input, the retired instructions of each variant, the
+number of instructions the custom encodings save and the retired
+instructions per input byte. The last line gives the marginal cost per
+byte of each variant: The difference of the retired counts of the
+longest and shortest inputs divided by the difference of their
+lengths, which cancels the start-up and output costs. Whisper's wall
+time is not used: It is noise at these run lengths.
+
+Example:
+  sha256_compare.py --whisper ./whisper --config swerv.json \\
+      sha256opt sha256zbb abc 0123456789abcdef0123456789abcdef
+"""
+
+import argparse
+import hashlib
+import re
+import subprocess
+import sys
+
+
+RETIRED = re.compile(r'Retired (\d+) instruction')
+DIGEST = re.compile(r'hash hex:\s*([0-9a-f]{64})')
+
+
+def run(whisper, extra, elf, text):
+    """Run the given program feeding it the given text. Return (digest,
+    retired instructions) or None on failure."""
+    cmd = [whisper] + extra + [elf]
+    proc = subprocess.run(cmd, input=text + '\n', stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE, universal_newlines=True)
+    retired = RETIRED.search(proc.stderr)
+    digest = DIGEST.search(proc.stdout)
+    if not retired or not digest:
+        return None
+    return digest.group(1), int(retired.group(1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('custom', help='sha256opt ELF file.')
+    parser.add_argument('zbb', help='sha256zbb ELF file.')
+    parser.add_argument('inputs', nargs='*',
+                        help='Input strings (no white space; default: a few sizes).')
+    parser.add_argument('--whisper', default='whisper',
+                        help='Path to the whisper executable.')
+    parser.add_argument('--config', help='Whisper configuration file.')
+    parser.add_argument('--whisper-args', default='--newlib',
+                        help='Whisper arguments (space separated).')
+    args = parser.parse_args()
+
+    extra = args.whisper_args.split()
+    if args.config:
+        extra += ['--configfile', args.config]
+    # Default inputs: 1 to 4 blocks once padded (sha256opt reads at
+    # most 255 characters).
+    inputs = args.inputs or ['abc', 'x' * 55, 'x' * 56, 'x' * 119, 'x' * 247]
+
+    header = '%6s %12s %12s %8s %7s %10s %10s' % (
+        'length', 'custom', 'zbb', 'saved', 'ratio', 'custom/B', 'zbb/B')
+    print(header)
+    print('-' * len(header))
+
+    errors = 0
+    counts = {}  # Length to (custom retired, zbb retired).
+    for text in inputs:
+        expected = hashlib.sha256(text.encode()).hexdigest()
+        custom = run(args.whisper, extra, args.custom, text)
+        zbb = run(args.whisper, extra, args.zbb, text)
+        if custom is None or zbb is None:
+            print('%6d run failed' % len(text))
+            errors += 1
+            continue
+        for name, result in (('custom', custom), ('zbb', zbb)):
+            if result[0] != expected:
+                print('%6d %s digest mismatch: %s expecting %s' %
+                      (len(text), name, result[0], expected))
+                errors += 1
+
+        c_insts, z_insts = custom[1], zbb[1]
+        counts[len(text)] = (c_insts, z_insts)
+        length = max(len(text), 1)
+        print('%6d %12d %12d %8d %7.3f %10.1f %10.1f' %
+              (len(text), c_insts, z_insts, z_insts - c_insts,
+               float(z_insts) / c_insts if c_insts else 0,
+               float(c_insts) / length, float(z_insts) / length))
+
+    if len(counts) > 1:
+        short, long = min(counts), max(counts)
+        delta = long - short
+        c_marginal = float(counts[long][0] - counts[short][0]) / delta
+        z_marginal = float(counts[long][1] - counts[short][1]) / delta
+        print('marginal instructions per byte (%d to %d bytes): custom %.2f '
+              'zbb %.2f ratio %.3f' % (short, long, c_marginal, z_marginal,
+                                       z_marginal / c_marginal if c_marginal else 0))
+
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
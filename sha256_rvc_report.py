@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+
+# Copyright 2020 Western Digital Corporation or its affiliates.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Report code size and fetch traffic of sha256opt_c vs sha256opt.
+
+sha256opt_c.s is sha256opt.s with the custom instructions of the form
+"op rd, rd, rs2" (rd and rs2 in x8-x15) in their 16-bit encoding. Build
+both programs with:
+
+  CC="riscv32-unknown-elf-gcc -march=rv32imac -mabi=ilp32"
+  $CC -o sha256opt sha256opt.s
+  $CC -o sha256opt_c sha256opt_c.s
+
+The static size of the sha256_* functions is taken from the symbol
+table (nm -S). Both programs are run under whisper on the same input
+with an instruction trace; the dynamic instruction count and fetched
+bytes (2 per compressed and 4 per other instruction) are derived from
+the trace. The digests are checked against hashlib.
+
+Example:
+  sha256_rvc_report.py --whisper ./whisper sha256opt sha256opt_c abc
+"""
+
+import argparse
+import hashlib
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+DIGEST = re.compile(r'hash hex:\s*([0-9a-f]{64})')
+
+# Trace line: #tag hart pc opcode resource address value assembly
+TRACE = re.compile(r'^#(\d+)\s+\d+\s+([0-9a-f]+)\s+([0-9a-f]+)\s')
+
+
+def function_ranges(nm, elf):
+    """Return the list of (start, end, name) of the sha256_* functions
+    of the given ELF file."""
+    out = subprocess.check_output([nm, '-S', elf], universal_newlines=True)
+    ranges = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[3].startswith('sha256_'):
+            start = int(fields[0], 16)
+            ranges.append((start, start + int(fields[1], 16), fields[3]))
+    return ranges
+
+
+def code_sizes(nm, elf):
+    """Return a dictionary mapping the sha256_* functions of the given
+    ELF file to their sizes in bytes."""
+    return {name: end - start for start, end, name in function_ranges(nm, elf)}
+
+
+def trace_run(whisper, extra, nm, elf, text):
+    """Run the program with an instruction trace. Return (digest,
+    total instructions, total fetched bytes, sha256 instructions,
+    sha256 fetched bytes, compressed sha256 instructions) or None on
+    failure."""
+    ranges = function_ranges(nm, elf)
+    with tempfile.TemporaryDirectory() as tmp:
+        log = os.path.join(tmp, 'trace.log')
+        cmd = [whisper] + extra + ['--logfile', log, elf]
+        proc = subprocess.run(cmd, input=text + '\n', stdout=subprocess.PIPE,
+                              stderr=subprocess.PIPE, universal_newlines=True)
+        digest = DIGEST.search(proc.stdout)
+        if not digest or not os.path.exists(log):
+            return None
+
+        insts = fetched = sha_insts = sha_fetched = sha_compressed = 0
+        last_tag = None
+        with open(log) as f:
+            for line in f:
+                match = TRACE.match(line)
+                if not match:
+                    continue
+                tag = match.group(1)
+                if tag == last_tag:
+                    continue   # Same instruction, other changed resource.
+                last_tag = tag
+                pc = int(match.group(2), 16)
+                size = 2 if len(match.group(3)) == 4 else 4
+                insts += 1
+                fetched += size
+                if any(start <= pc < end for start, end, _ in ranges):
+                    sha_insts += 1
+                    sha_fetched += size
+                    sha_compressed += size == 2
+    return digest.group(1), insts, fetched, sha_insts, sha_fetched, sha_compressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('base', help='sha256opt ELF file.')
+    parser.add_argument('compressed', help='sha256opt_c ELF file.')
+    parser.add_argument('input', nargs='?', default='x' * 200,
+                        help='Input string (no white space).')
+    parser.add_argument('--whisper', default='whisper',
+                        help='Path to the whisper executable.')
+    parser.add_argument('--whisper-args', default='--newlib',
+                        help='Whisper arguments (space separated).')
+    parser.add_argument('--nm', default='nm',
+                        help='nm program to read the symbol tables.')
+    args = parser.parse_args()
+    extra = args.whisper_args.split()
+
+    base_sizes = code_sizes(args.nm, args.base)
+    comp_sizes = code_sizes(args.nm, args.compressed)
+
+    print('Static code size (bytes)')
+    print('%-18s %8s %8s %8s' % ('function', 'base', 'rvc', 'saved'))
+    for name in sorted(base_sizes):
+        b, c = base_sizes[name], comp_sizes.get(name, 0)
+        print('%-18s %8d %8d %7.1f%%' % (name, b, c, 100.0 * (b - c) / b if b else 0))
+    b, c = sum(base_sizes.values()), sum(comp_sizes.values())
+    print('%-18s %8d %8d %7.1f%%' % ('total', b, c, 100.0 * (b - c) / b if b else 0))
+
+    expected = hashlib.sha256(args.input.encode()).hexdigest()
+    base = trace_run(args.whisper, extra, args.nm, args.base, args.input)
+    comp = trace_run(args.whisper, extra, args.nm, args.compressed, args.input)
+    if base is None or comp is None:
+        print('run failed')
+        return 1
+
+    errors = 0
+    for name, result in (('base', base), ('rvc', comp)):
+        if result[0] != expected:
+            print('%s digest mismatch: %s expecting %s' % (name, result[0], expected))
+            errors += 1
+
+    print()
+    print('Dynamic (input length %d)' % len(args.input))
+    print('%-26s %10s %10s %8s' % ('', 'base', 'rvc', 'saved'))
+    rows = (('instructions', 1), ('fetched bytes', 2),
+            ('sha256 instructions', 3), ('sha256 fetched bytes', 4),
+            ('sha256 compressed insts', 5))
+    for label, ix in rows:
+        bv, cv = base[ix], comp[ix]
+        saved = '%7.1f%%' % (100.0 * (bv - cv) / bv) if bv and ix in (2, 4) else ''
+        print('%-26s %10d %10d %8s' % (label, bv, cv, saved))
+
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())